@@ -1,9 +1,13 @@
 #include "allocations_checker.h"
 
+#include <algorithm>
 #include <atomic>
+#include <bit>
 #include <new>
 #include <stdexcept>
 
+#include <execinfo.h>
+#include <malloc.h>
 #include <stdlib.h>
 
 #if defined(__has_feature)
@@ -13,31 +17,199 @@
 #endif
 #endif
 
-std::atomic<size_t> allocations_count{0}, deallocations_count{0};
+namespace {
+
+using alloc_checker::kSizeClasses;
+
+// Every thread hits its own cache line, the totals are summed up on demand. The shards are
+// constant-initialized, so the hooks work even before `main`
+constexpr size_t kShards = 64;
+
+struct alignas(64) Shard {
+    std::atomic<size_t> allocations;
+    std::atomic<size_t> deallocations;
+    std::atomic<size_t> allocated_bytes;
+    std::array<std::atomic<size_t>, kSizeClasses> class_allocations;
+    std::array<std::atomic<size_t>, kSizeClasses> class_live_bytes;  // may wrap, only sums matter
+};
+
+Shard shards[kShards];
+std::atomic<size_t> next_shard{0};
+
+// Thread-local state must stay trivial: a destructor would make the runtime allocate on the first
+// access, i.e. inside the hook
+constexpr size_t kNoShard = ~size_t{0};
+thread_local size_t shard_index = kNoShard;
+thread_local size_t sample_countdown = 0;
+thread_local bool inside_sampler = false;
+thread_local bool fail_next_allocation = false;
+
+constexpr size_t kMaxSamples = 1024;
+
+std::atomic<size_t> sample_every{0};
+std::atomic_flag samples_lock = ATOMIC_FLAG_INIT;
+std::array<alloc_checker::AllocationSample, kMaxSamples> samples;
+size_t samples_written = 0;
+
+Shard& LocalShard() {
+    if (shard_index == kNoShard) {
+        shard_index = next_shard.fetch_add(1, std::memory_order_relaxed) % kShards;
+    }
+    return shards[shard_index];
+}
+
+size_t SizeClass(size_t size) {
+    auto index = size == 0 ? 0 : static_cast<size_t>(std::bit_width(size - 1));
+    return std::min(index, kSizeClasses - 1);
+}
+
+size_t UsableSize(const volatile void* ptr) {
+    auto p = const_cast<void*>(ptr);  // NOLINT: the allocator APIs aren't volatile-aware
+#ifdef HAS_SANITIZER
+    return __sanitizer_get_allocated_size(p);
+#else
+    return malloc_usable_size(p);
+#endif
+}
+
+template <class F>
+void WithSamplesLocked(F&& func) {
+    while (samples_lock.test_and_set(std::memory_order_acquire)) {
+    }
+    func();
+    samples_lock.clear(std::memory_order_release);
+}
+
+void MaybeSample(size_t size) {
+    auto every = sample_every.load(std::memory_order_relaxed);
+    if (every == 0 || inside_sampler) {
+        return;
+    }
+    if (sample_countdown == 0 || sample_countdown > every) {
+        sample_countdown = every;
+    }
+    if (--sample_countdown != 0) {
+        return;
+    }
+
+    // `backtrace` may allocate on its first call, don't sample that allocation
+    inside_sampler = true;
+    alloc_checker::AllocationSample sample;
+    sample.size = size;
+    sample.depth = static_cast<size_t>(backtrace(sample.frames.data(), sample.frames.size()));
+    WithSamplesLocked([&sample] { samples[samples_written++ % kMaxSamples] = sample; });
+    inside_sampler = false;
+}
+
+[[maybe_unused]] void MaybeFail() {
+    if (fail_next_allocation) {
+        fail_next_allocation = false;
+        throw std::bad_alloc();
+    }
+}
+
+size_t Sum(std::atomic<size_t> Shard::*counter) {
+    size_t result = 0;
+    for (auto& shard : shards) {
+        result += (shard.*counter).load(std::memory_order_relaxed);
+    }
+    return result;
+}
+
+}  // namespace
 
 namespace alloc_checker {
 
 size_t AllocCount() {
-    return allocations_count.load();
+    return Sum(&Shard::allocations);
 }
 
 size_t DeallocCount() {
-    return deallocations_count.load();
+    return Sum(&Shard::deallocations);
+}
+
+size_t AllocatedBytes() {
+    return Sum(&Shard::allocated_bytes);
 }
 
 void ResetCounters() {
-    allocations_count.store(0);
-    deallocations_count.store(0);
+    for (auto& shard : shards) {
+        shard.allocations.store(0);
+        shard.deallocations.store(0);
+        shard.allocated_bytes.store(0);
+        for (auto& counter : shard.class_allocations) {
+            counter.store(0);
+        }
+    }
+}
+
+AllocationSnapshot Snapshot() {
+    AllocationSnapshot snapshot;
+    snapshot.allocations = AllocCount();
+    snapshot.deallocations = DeallocCount();
+    snapshot.allocated_bytes = AllocatedBytes();
+    for (size_t i = 0; i < kSizeClasses; ++i) {
+        auto& stats = snapshot.size_classes[i];
+        stats.max_size = i + 1 < kSizeClasses ? size_t{1} << i : ~size_t{0};
+        for (auto& shard : shards) {
+            stats.allocations += shard.class_allocations[i].load(std::memory_order_relaxed);
+            stats.live_bytes += shard.class_live_bytes[i].load(std::memory_order_relaxed);
+        }
+    }
+    return snapshot;
+}
+
+void SetBacktraceSampling(size_t every_nth) {
+    sample_every.store(every_nth);
+}
+
+std::vector<AllocationSample> Samples() {
+    std::vector<AllocationSample> result;
+    result.reserve(kMaxSamples);  // allocate before taking the lock the hook may need
+    WithSamplesLocked([&result] {
+        auto count = std::min(samples_written, kMaxSamples);
+        for (size_t i = samples_written - count; i < samples_written; ++i) {
+            result.push_back(samples[i % kMaxSamples]);
+        }
+    });
+    return result;
+}
+
+void ClearSamples() {
+    WithSamplesLocked([] { samples_written = 0; });
+}
+
+bool FailNextAllocation() {
+#ifdef HAS_SANITIZER
+    return false;
+#else
+    fail_next_allocation = true;
+    return true;
+#endif
 }
 
 }  // namespace alloc_checker
 
-void MallocHook(const volatile void*, size_t) {
-    allocations_count.fetch_add(1);
+void MallocHook(const volatile void* ptr, size_t size) {
+    auto& shard = LocalShard();
+    shard.allocations.fetch_add(1, std::memory_order_relaxed);
+    shard.allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+    if (ptr != nullptr) {
+        auto usable = UsableSize(ptr);
+        auto size_class = SizeClass(usable);
+        shard.class_allocations[size_class].fetch_add(1, std::memory_order_relaxed);
+        shard.class_live_bytes[size_class].fetch_add(usable, std::memory_order_relaxed);
+    }
+    MaybeSample(size);
 }
 
-void FreeHook(const volatile void*) {
-    deallocations_count.fetch_add(1);
+void FreeHook(const volatile void* ptr) {
+    auto& shard = LocalShard();
+    shard.deallocations.fetch_add(1, std::memory_order_relaxed);
+    if (ptr != nullptr) {
+        auto usable = UsableSize(ptr);
+        shard.class_live_bytes[SizeClass(usable)].fetch_sub(usable, std::memory_order_relaxed);
+    }
 }
 
 #ifdef HAS_SANITIZER
@@ -50,6 +222,7 @@ void FreeHook(const volatile void*) {
 }();
 #else
 void* operator new(size_t size) {
+    MaybeFail();
     void* p = malloc(size);
     MallocHook(p, size);
     return p;
@@ -62,6 +235,7 @@ void* operator new(size_t size, const std::nothrow_t&) noexcept {
 }
 
 void* operator new[] (size_t size) {
+    MaybeFail();
     void* p = malloc(size);
     MallocHook(p, size);
     return p;
@@ -92,4 +266,47 @@ void operator delete[] (void* p, size_t) noexcept {
     FreeHook(p);
     free(p);
 }
+
+// Over-aligned types, e.g. cache-line aligned blocks
+void* operator new(size_t size, std::align_val_t alignment) {
+    MaybeFail();
+    auto align = static_cast<size_t>(alignment);
+    void* p = aligned_alloc(align, (size + align - 1) / align * align);
+    MallocHook(p, size);
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    auto align = static_cast<size_t>(alignment);
+    void* p = aligned_alloc(align, (size + align - 1) / align * align);
+    MallocHook(p, size);
+    return p;
+}
+
+void* operator new[] (size_t size, std::align_val_t alignment) {
+    return operator new(size, alignment);
+}
+
+void operator delete(void* p, std::align_val_t) noexcept {
+    FreeHook(p);
+    free(p);
+}
+
+void operator delete(void* p, size_t, std::align_val_t) noexcept {
+    FreeHook(p);
+    free(p);
+}
+
+void operator delete[] (void* p, std::align_val_t) noexcept {
+    FreeHook(p);
+    free(p);
+}
+
+void operator delete[] (void* p, size_t, std::align_val_t) noexcept {
+    FreeHook(p);
+    free(p);
+}
 #endif
@@ -1,15 +1,58 @@
 #pragma once
 
+#include <array>
 #include <cstddef>
+#include <vector>
 
 namespace alloc_checker {
 
+// Size class `i` holds allocations of (2^(i - 1), 2^i] bytes, the last one everything bigger
+inline constexpr std::size_t kSizeClasses = 32;
+
+inline constexpr std::size_t kMaxBacktraceFrames = 16;
+
+struct SizeClassStats {
+    std::size_t max_size = 0;     // upper bound of the class, inclusive
+    std::size_t allocations = 0;  // since the last `ResetCounters()`
+    std::size_t live_bytes = 0;   // allocator's usable size of the blocks that are still alive
+};
+
+struct AllocationSnapshot {
+    std::size_t allocations = 0;
+    std::size_t deallocations = 0;
+    std::size_t allocated_bytes = 0;  // requested by the callers
+    std::array<SizeClassStats, kSizeClasses> size_classes;
+};
+
+struct AllocationSample {
+    std::size_t size = 0;
+    std::size_t depth = 0;
+    std::array<void*, kMaxBacktraceFrames> frames{};
+};
+
 std::size_t AllocCount();
 
 std::size_t DeallocCount();
 
+std::size_t AllocatedBytes();
+
+// Counts, bytes and per-class allocations start over, live bytes are kept
 void ResetCounters();
 
+AllocationSnapshot Snapshot();
+
+// Capture the backtrace of every `every_nth` allocation of each thread, 0 turns it off
+void SetBacktraceSampling(std::size_t every_nth);
+
+// The most recent samples, the oldest ones are overwritten
+std::vector<AllocationSample> Samples();
+
+void ClearSamples();
+
+// The next throwing `operator new` of this thread throws `std::bad_alloc`, for testing the failure
+// paths. Sanitizer builds keep the sanitizer's `operator new`: nothing fails there and it's false
+bool FailNextAllocation();
+
 }  // namespace alloc_checker
 
 #define EXPECT_ZERO_ALLOCATIONS(X)                     \
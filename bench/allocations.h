@@ -0,0 +1,26 @@
+#pragma once
+
+#include "allocations_checker.h"
+
+#include <benchmark/benchmark.h>
+
+// Reports the number of heap allocations per iteration as the "allocs" counter.
+// The checker counts allocations of the whole process, so use it in single-threaded runs only
+class AllocationsPerIteration {
+public:
+    explicit AllocationsPerIteration(benchmark::State& state)
+        : state_(state), start_(alloc_checker::AllocCount()) {
+    }
+
+    AllocationsPerIteration(const AllocationsPerIteration&) = delete;
+    AllocationsPerIteration& operator=(const AllocationsPerIteration&) = delete;
+
+    ~AllocationsPerIteration() {
+        auto count = static_cast<double>(alloc_checker::AllocCount() - start_);
+        state_.counters["allocs"] = benchmark::Counter(count, benchmark::Counter::kAvgIterations);
+    }
+
+private:
+    benchmark::State& state_;
+    size_t start_;
+};
@@ -0,0 +1,103 @@
+#include <shared-from-this/atomic_shared.h>
+
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <mutex>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Readers grab the current version of a shared table, in the `WithWriter` runs thread 0 keeps
+// publishing new ones instead
+
+namespace {
+
+struct Table {
+    int version = 0;
+};
+
+class MutexSharedPtr {
+public:
+    SharedPtr<const Table> Load() const {
+        std::lock_guard guard(mutex_);
+        return value_;
+    }
+
+    void Store(SharedPtr<const Table> value) {
+        std::lock_guard guard(mutex_);
+        value_.Swap(value);
+    }
+
+private:
+    mutable std::mutex mutex_;
+    SharedPtr<const Table> value_ = MakeShared<Table>();
+};
+
+class StdAtomicSharedPtr {
+public:
+    std::shared_ptr<const Table> Load() const {
+        return value_.load();
+    }
+
+    void Store(std::shared_ptr<const Table> value) {
+        value_.store(std::move(value));
+    }
+
+private:
+    std::atomic<std::shared_ptr<const Table>> value_{std::make_shared<Table>()};
+};
+
+MutexSharedPtr mutex_ptr;
+AtomicSharedPtr<const Table> atomic_ptr(MakeShared<Table>());
+StdAtomicSharedPtr std_atomic_ptr;
+
+template <class Ptr, class Make>
+void Run(benchmark::State& state, Ptr& ptr, Make make, bool with_writer) {
+    if (with_writer && state.thread_index() == 0) {
+        for (auto _ : state) {
+            ptr.Store(make());
+        }
+        return;
+    }
+    for (auto _ : state) {
+        auto table = ptr.Load();
+        benchmark::DoNotOptimize(table->version);
+    }
+}
+
+auto make_table = [] { return MakeShared<Table>(); };
+auto make_std_table = [] { return std::make_shared<Table>(); };
+
+}  // namespace
+
+void MutexLoad(benchmark::State& state) {
+    Run(state, mutex_ptr, make_table, false);
+}
+
+void AtomicSharedPtrLoad(benchmark::State& state) {
+    Run(state, atomic_ptr, make_table, false);
+}
+
+void StdAtomicSharedPtrLoad(benchmark::State& state) {
+    Run(state, std_atomic_ptr, make_std_table, false);
+}
+
+void MutexLoadWithWriter(benchmark::State& state) {
+    Run(state, mutex_ptr, make_table, true);
+}
+
+void AtomicSharedPtrLoadWithWriter(benchmark::State& state) {
+    Run(state, atomic_ptr, make_table, true);
+}
+
+void StdAtomicSharedPtrLoadWithWriter(benchmark::State& state) {
+    Run(state, std_atomic_ptr, make_std_table, true);
+}
+
+BENCHMARK(MutexLoad)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK(AtomicSharedPtrLoad)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK(StdAtomicSharedPtrLoad)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK(MutexLoadWithWriter)->ThreadRange(2, 8)->UseRealTime();
+BENCHMARK(AtomicSharedPtrLoadWithWriter)->ThreadRange(2, 8)->UseRealTime();
+BENCHMARK(StdAtomicSharedPtrLoadWithWriter)->ThreadRange(2, 8)->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,58 @@
+#include <shared-from-this/shared.h>
+#include <shared-from-this/weak.h>
+
+#include <benchmark/benchmark.h>
+
+#include <memory>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Copying a pointer to an `EnableSharedFromThis` object should cost the same as to a plain one
+
+namespace {
+
+struct Plain {
+    int value = 0;
+};
+
+struct Session : EnableSharedFromThis<Session> {
+    int value = 0;
+};
+
+struct StdSession : std::enable_shared_from_this<StdSession> {
+    int value = 0;
+};
+
+template <class Ptr>
+void Copy(benchmark::State& state, const Ptr& original) {
+    for (auto _ : state) {
+        Ptr copy = original;
+        benchmark::DoNotOptimize(copy);
+    }
+}
+
+}  // namespace
+
+void CopyPlain(benchmark::State& state) {
+    Copy(state, MakeShared<Plain>());
+}
+
+void CopySession(benchmark::State& state) {
+    Copy(state, MakeShared<Session>());
+}
+
+void CopySessionWithWeakPtr(benchmark::State& state) {
+    auto session = MakeShared<Session>();
+    WeakPtr<Session> weak(session);
+    Copy(state, session);
+}
+
+void CopyStdSession(benchmark::State& state) {
+    Copy(state, std::make_shared<StdSession>());
+}
+
+BENCHMARK(CopyPlain);
+BENCHMARK(CopySession);
+BENCHMARK(CopySessionWithWeakPtr);
+BENCHMARK(CopyStdSession);
+
+BENCHMARK_MAIN();
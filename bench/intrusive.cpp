@@ -0,0 +1,188 @@
+#include "allocations.h"
+
+#include <intrusive/intrusive.h>
+#include <intrusive/lock_free.h>
+
+#include <benchmark/benchmark.h>
+
+#include <deque>
+#include <mutex>
+#include <vector>
+
+#if __has_include(<boost/intrusive_ptr.hpp>)
+#include <boost/intrusive_ptr.hpp>
+#include <boost/smart_ptr/intrusive_ref_counter.hpp>
+#define HAS_BOOST_INTRUSIVE_PTR
+#endif
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+struct Simple : SimpleRefCounted<Simple> {
+    int value = 0;
+};
+
+struct ThreadSafe : ThreadSafeRefCounted<ThreadSafe> {
+    int value = 0;
+};
+
+template <class Ptr>
+void Copy(benchmark::State& state, const Ptr& original) {
+    AllocationsPerIteration allocs(state);
+    for (auto _ : state) {
+        Ptr copy = original;
+        benchmark::DoNotOptimize(copy);
+    }
+}
+
+template <class Ptr>
+void Move(benchmark::State& state, Ptr ptr) {
+    AllocationsPerIteration allocs(state);
+    for (auto _ : state) {
+        Ptr other = std::move(ptr);
+        benchmark::DoNotOptimize(other);
+        ptr = std::move(other);
+    }
+}
+
+}  // namespace
+
+void IntrusivePtrCopy(benchmark::State& state) {
+    Copy(state, MakeIntrusive<Simple>());
+}
+
+void IntrusivePtrCopyThreadSafe(benchmark::State& state) {
+    Copy(state, MakeIntrusive<ThreadSafe>());
+}
+
+void IntrusivePtrMove(benchmark::State& state) {
+    Move(state, MakeIntrusive<ThreadSafe>());
+}
+
+BENCHMARK(IntrusivePtrCopy);
+BENCHMARK(IntrusivePtrCopyThreadSafe);
+BENCHMARK(IntrusivePtrMove);
+
+#ifdef HAS_BOOST_INTRUSIVE_PTR
+namespace {
+
+struct BoostSimple : boost::intrusive_ref_counter<BoostSimple, boost::thread_unsafe_counter> {
+    int value = 0;
+};
+
+struct BoostThreadSafe : boost::intrusive_ref_counter<BoostThreadSafe> {
+    int value = 0;
+};
+
+}  // namespace
+
+void BoostIntrusivePtrCopy(benchmark::State& state) {
+    Copy(state, boost::intrusive_ptr<BoostSimple>(new BoostSimple));
+}
+
+void BoostIntrusivePtrCopyThreadSafe(benchmark::State& state) {
+    Copy(state, boost::intrusive_ptr<BoostThreadSafe>(new BoostThreadSafe));
+}
+
+void BoostIntrusivePtrMove(benchmark::State& state) {
+    Move(state, boost::intrusive_ptr<BoostThreadSafe>(new BoostThreadSafe));
+}
+
+BENCHMARK(BoostIntrusivePtrCopy);
+BENCHMARK(BoostIntrusivePtrCopyThreadSafe);
+BENCHMARK(BoostIntrusivePtrMove);
+#endif
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Handing buffers over between threads: a mutex around `std::deque` vs the lock-free containers
+
+namespace {
+
+struct Buffer : ThreadSafeRefCounted<Buffer>, LockFreeHook {
+    int value = 0;
+};
+
+class LockedDeque {
+public:
+    void Push(IntrusivePtr<Buffer> ptr) {
+        std::lock_guard guard(mutex_);
+        deque_.push_back(std::move(ptr));
+    }
+
+    IntrusivePtr<Buffer> Pop() {
+        std::lock_guard guard(mutex_);
+        if (deque_.empty()) {
+            return {};
+        }
+        auto ptr = std::move(deque_.front());
+        deque_.pop_front();
+        return ptr;
+    }
+
+private:
+    std::mutex mutex_;
+    std::deque<IntrusivePtr<Buffer>> deque_;
+};
+
+// One thread: push and pop the same buffer
+template <class Container>
+void RoundTrip(benchmark::State& state) {
+    AllocationsPerIteration allocs(state);
+    Container container;
+    auto buffer = MakeIntrusive<Buffer>();
+    for (auto _ : state) {
+        container.Push(std::move(buffer));
+        buffer = container.Pop();
+        benchmark::DoNotOptimize(buffer.Get());
+    }
+}
+
+// Thread 0 consumes, the others produce one buffer per iteration. A queued buffer can't be pushed
+// again, so every push makes a new one, in both variants
+template <class Container>
+void Handoff(benchmark::State& state) {
+    static Container container;
+    if (state.thread_index() == 0) {
+        for (auto _ : state) {
+            while (auto buffer = container.Pop()) {
+                benchmark::DoNotOptimize(buffer.Get());
+            }
+        }
+    } else {
+        for (auto _ : state) {
+            container.Push(MakeIntrusive<Buffer>());
+        }
+        state.SetItemsProcessed(state.iterations());
+    }
+}
+
+}  // namespace
+
+void HandoffRoundTripLockedDeque(benchmark::State& state) {
+    RoundTrip<LockedDeque>(state);
+}
+
+void HandoffRoundTripMPSCQueue(benchmark::State& state) {
+    RoundTrip<IntrusiveMPSCQueue<Buffer>>(state);
+}
+
+void HandoffRoundTripStack(benchmark::State& state) {
+    RoundTrip<IntrusiveStack<Buffer>>(state);
+}
+
+void HandoffLockedDeque(benchmark::State& state) {
+    Handoff<LockedDeque>(state);
+}
+
+void HandoffMPSCQueue(benchmark::State& state) {
+    Handoff<IntrusiveMPSCQueue<Buffer>>(state);
+}
+
+BENCHMARK(HandoffRoundTripLockedDeque);
+BENCHMARK(HandoffRoundTripMPSCQueue);
+BENCHMARK(HandoffRoundTripStack);
+BENCHMARK(HandoffLockedDeque)->ThreadRange(2, 8)->UseRealTime();
+BENCHMARK(HandoffMPSCQueue)->ThreadRange(2, 8)->UseRealTime();
+
+BENCHMARK_MAIN();
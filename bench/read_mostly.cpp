@@ -0,0 +1,46 @@
+#include <shared-from-this/hazard.h>
+#include <shared-from-this/shared.h>
+
+#include <benchmark/benchmark.h>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Every thread reads the same hot object: copying the `SharedPtr` bounces the control block
+// between cores, a hazard pointer only writes to the reader's own slot
+
+namespace {
+
+struct Table {
+    int version = 0;
+};
+
+const auto kTable = MakeShared<Table>();
+ReadMostly<SharedPtr<Table>> read_mostly(MakeShared<Table>());
+
+}  // namespace
+
+void SharedPtrCopy(benchmark::State& state) {
+    for (auto _ : state) {
+        auto table = kTable;
+        benchmark::DoNotOptimize(table->version);
+    }
+}
+
+void ReadMostlyProtect(benchmark::State& state) {
+    HazardPtr hazard;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(read_mostly.Protect(hazard)->version);
+    }
+}
+
+void ReadMostlyLoad(benchmark::State& state) {
+    for (auto _ : state) {
+        auto table = read_mostly.Load();
+        benchmark::DoNotOptimize(table->version);
+    }
+}
+
+BENCHMARK(SharedPtrCopy)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK(ReadMostlyProtect)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK(ReadMostlyLoad)->ThreadRange(1, 8)->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,75 @@
+#include <common/relocating_vector.h>
+#include <shared-from-this/shared.h>
+
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Filling an array of `range(0)` handles without `reserve`: `std::vector` moves and destroys every
+// element on each growth, `RelocatingVector` reallocs. The handles are made once, untimed, and only
+// their copies are pushed, so the loop is the growth and the copy
+
+namespace {
+
+struct Payload {
+    int value = 0;
+};
+
+template <class Vector, class Push>
+void Fill(benchmark::State& state, Push push) {
+    const auto size = static_cast<size_t>(state.range(0));
+    for (auto _ : state) {
+        Vector handles;
+        for (size_t i = 0; i < size; ++i) {
+            push(handles, i);
+        }
+        benchmark::DoNotOptimize(handles.Data());
+        state.PauseTiming();
+        {
+            Vector dropped(std::move(handles));  // the teardown isn't what's measured
+        }
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// `std::vector` under the names `Fill` uses
+template <class T>
+struct StdVector : std::vector<T> {
+    T* Data() noexcept {
+        return this->data();
+    }
+};
+
+const std::vector<SharedPtr<Payload>>& Handles() {
+    static const auto kHandles = [] {
+        std::vector<SharedPtr<Payload>> handles;
+        for (size_t i = 0; i < (1 << 22); ++i) {
+            handles.push_back(MakeShared<Payload>());
+        }
+        return handles;
+    }();
+    return kHandles;
+}
+
+}  // namespace
+
+void GrowSharedStdVector(benchmark::State& state) {
+    const auto& handles = Handles();
+    Fill<StdVector<SharedPtr<Payload>>>(state, [&](auto& vector, size_t i) {
+        vector.push_back(handles[i]);
+    });
+}
+
+void GrowSharedRelocating(benchmark::State& state) {
+    const auto& handles = Handles();
+    Fill<RelocatingVector<SharedPtr<Payload>>>(state, [&](auto& vector, size_t i) {
+        vector.PushBack(handles[i]);
+    });
+}
+
+BENCHMARK(GrowSharedStdVector)->Range(1 << 10, 1 << 22);
+BENCHMARK(GrowSharedRelocating)->Range(1 << 10, 1 << 22);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,355 @@
+#include "allocations.h"
+
+#include <common/instrumentation.h>
+#include <shared-from-this/borrowed.h>
+#include <shared-from-this/compact_shared.h>
+#include <shared-from-this/biased_ref_count.h>
+#include <shared-from-this/packed_ref_count.h>
+#include <shared-from-this/shared.h>
+#include <shared-from-this/weak.h>
+
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Copy + destroy of a pointer whose object stays alive
+
+namespace {
+
+struct Payload {
+    int value = 0;
+};
+
+const auto kShared = MakeShared<Payload>();
+const auto kSingleThreaded = MakeShared<Payload, SingleThreadedRefCount>();
+const auto kBiased = MakeShared<Payload, BiasedRefCount>();  // owned by the main thread
+const auto kStdShared = std::make_shared<Payload>();
+
+template <class Ptr>
+void CopyDestroy(benchmark::State& state, const Ptr& original) {
+    for (auto _ : state) {
+        Ptr copy = original;
+        benchmark::DoNotOptimize(copy);
+    }
+}
+
+}  // namespace
+
+void SharedPtrCopy(benchmark::State& state) {
+    AllocationsPerIteration allocs(state);
+    CopyDestroy(state, kShared);
+}
+
+void SharedPtrCopySingleThreaded(benchmark::State& state) {
+    AllocationsPerIteration allocs(state);
+    CopyDestroy(state, kSingleThreaded);
+}
+
+void SharedPtrCopyBiased(benchmark::State& state) {
+    AllocationsPerIteration allocs(state);
+    CopyDestroy(state, kBiased);
+}
+
+void StdSharedPtrCopy(benchmark::State& state) {
+    AllocationsPerIteration allocs(state);
+    CopyDestroy(state, kStdShared);
+}
+
+// All threads hammer the counters of one object
+void SharedPtrCopyContended(benchmark::State& state) {
+    CopyDestroy(state, kShared);
+}
+
+// Thread 0 is the owner, the rest take the atomic path
+void SharedPtrCopyBiasedContended(benchmark::State& state) {
+    CopyDestroy(state, kBiased);
+}
+
+void StdSharedPtrCopyContended(benchmark::State& state) {
+    CopyDestroy(state, kStdShared);
+}
+
+BENCHMARK(SharedPtrCopy);
+BENCHMARK(SharedPtrCopySingleThreaded);
+BENCHMARK(SharedPtrCopyBiased);
+BENCHMARK(StdSharedPtrCopy);
+BENCHMARK(SharedPtrCopyContended)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK(SharedPtrCopyBiasedContended)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK(StdSharedPtrCopyContended)->ThreadRange(1, 16)->UseRealTime();
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Thread 0 keeps writing to the object while the others copy the pointer. With `MakeShared` the
+// copies' RMWs steal the line the writer is using, the "writes" counter is the writer's throughput
+
+namespace {
+
+struct Written {
+    std::atomic<int64_t> value = 0;
+};
+
+const auto kWritten = MakeShared<Written>();
+const auto kWrittenIsolated = MakeSharedIsolated<Written>();
+
+void WriterAndCopiers(benchmark::State& state, const SharedPtr<Written>& ptr) {
+    if (state.thread_index() == 0) {
+        for (auto _ : state) {
+            ptr->value.store(ptr->value.load(std::memory_order_relaxed) + 1,
+                             std::memory_order_relaxed);
+        }
+        state.counters["writes"] =
+            benchmark::Counter(static_cast<double>(state.iterations()), benchmark::Counter::kIsRate);
+    } else {
+        CopyDestroy(state, ptr);
+    }
+}
+
+}  // namespace
+
+void FalseSharingMakeShared(benchmark::State& state) {
+    WriterAndCopiers(state, kWritten);
+}
+
+void FalseSharingIsolated(benchmark::State& state) {
+    WriterAndCopiers(state, kWrittenIsolated);
+}
+
+BENCHMARK(FalseSharingMakeShared)->ThreadRange(2, 16)->UseRealTime();
+BENCHMARK(FalseSharingIsolated)->ThreadRange(2, 16)->UseRealTime();
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Construction + destruction of a new object
+
+void MakeSharedCreate(benchmark::State& state) {
+    AllocationsPerIteration allocs(state);
+    for (auto _ : state) {
+        auto ptr = MakeShared<Payload>();
+        benchmark::DoNotOptimize(ptr.Get());
+    }
+}
+
+void RawPointerCreate(benchmark::State& state) {
+    AllocationsPerIteration allocs(state);
+    for (auto _ : state) {
+        SharedPtr<Payload> ptr(new Payload);
+        benchmark::DoNotOptimize(ptr.Get());
+    }
+}
+
+void StdMakeSharedCreate(benchmark::State& state) {
+    AllocationsPerIteration allocs(state);
+    for (auto _ : state) {
+        auto ptr = std::make_shared<Payload>();
+        benchmark::DoNotOptimize(ptr.get());
+    }
+}
+
+void StdRawPointerCreate(benchmark::State& state) {
+    AllocationsPerIteration allocs(state);
+    for (auto _ : state) {
+        std::shared_ptr<Payload> ptr(new Payload);
+        benchmark::DoNotOptimize(ptr.get());
+    }
+}
+
+BENCHMARK(MakeSharedCreate);
+BENCHMARK(RawPointerCreate);
+BENCHMARK(StdMakeSharedCreate);
+BENCHMARK(StdRawPointerCreate);
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Uncontended `WeakPtr::Lock`, see weak_lock.cpp for the contended one
+
+void WeakPtrLockOnce(benchmark::State& state) {
+    AllocationsPerIteration allocs(state);
+    WeakPtr<Payload> weak(kShared);
+    for (auto _ : state) {
+        auto locked = weak.Lock();
+        benchmark::DoNotOptimize(locked.Get());
+    }
+}
+
+void StdWeakPtrLockOnce(benchmark::State& state) {
+    AllocationsPerIteration allocs(state);
+    std::weak_ptr<Payload> weak(kStdShared);
+    for (auto _ : state) {
+        auto locked = weak.lock();
+        benchmark::DoNotOptimize(locked.get());
+    }
+}
+
+BENCHMARK(WeakPtrLockOnce);
+BENCHMARK(StdWeakPtrLockOnce);
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Heap bytes per small object, as the allocator sees them, reported in the "bytes" counter
+
+namespace {
+
+size_t LiveBytes() {
+    size_t bytes = 0;
+    for (const auto& size_class : alloc_checker::Snapshot().size_classes) {
+        bytes += size_class.live_bytes;
+    }
+    return bytes;
+}
+
+template <class Make>
+void MemoryPerObject(benchmark::State& state, Make make) {
+    constexpr size_t kCount = 1 << 16;
+    double bytes = 0;
+    for (auto _ : state) {
+        std::vector<decltype(make())> objects;
+        objects.reserve(kCount);
+        auto before = LiveBytes();
+        for (size_t i = 0; i < kCount; ++i) {
+            objects.push_back(make());
+        }
+        bytes = static_cast<double>(LiveBytes() - before) / kCount;
+    }
+    state.counters["bytes"] = bytes;
+}
+
+}  // namespace
+
+void MemoryPerObjectAtomic(benchmark::State& state) {
+    MemoryPerObject(state, [] { return MakeShared<Payload>(); });
+}
+
+void MemoryPerObjectPacked(benchmark::State& state) {
+    MemoryPerObject(state, [] { return MakeShared<Payload, PackedRefCount>(); });
+}
+
+void MemoryPerObjectRawPointerAtomic(benchmark::State& state) {
+    MemoryPerObject(state, [] { return SharedPtr<Payload>(new Payload); });
+}
+
+void MemoryPerObjectRawPointerPacked(benchmark::State& state) {
+    MemoryPerObject(state, [] { return SharedPtr<Payload, PackedRefCount>(new Payload); });
+}
+
+void MemoryPerObjectStd(benchmark::State& state) {
+    MemoryPerObject(state, [] { return std::make_shared<Payload>(); });
+}
+
+BENCHMARK(MemoryPerObjectAtomic);
+BENCHMARK(MemoryPerObjectPacked);
+BENCHMARK(MemoryPerObjectRawPointerAtomic);
+BENCHMARK(MemoryPerObjectRawPointerPacked);
+BENCHMARK(MemoryPerObjectStd);
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Copy + destroy with the packed and the instrumented policies
+
+void SharedPtrCopyPacked(benchmark::State& state) {
+    static const auto kPacked = MakeShared<Payload, PackedRefCount>();
+    CopyDestroy(state, kPacked);
+}
+
+void SharedPtrCopyInstrumented(benchmark::State& state) {
+    static const auto kInstrumented = MakeShared<Payload, InstrumentedRefCount<>>();
+    CopyDestroy(state, kInstrumented);
+}
+
+void SharedPtrCreatePacked(benchmark::State& state) {
+    for (auto _ : state) {
+        auto ptr = MakeShared<Payload, PackedRefCount>();
+        benchmark::DoNotOptimize(ptr.Get());
+    }
+}
+
+BENCHMARK(SharedPtrCopyPacked);
+BENCHMARK(SharedPtrCopyInstrumented);
+BENCHMARK(SharedPtrCreatePacked);
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// A pointer passed down a chain of calls, by value vs borrowed
+
+namespace {
+
+constexpr int kCallDepth = 8;
+
+[[gnu::noinline]] int PassShared(SharedPtr<Payload> ptr, int depth) {
+    if (depth == 0) {
+        return ptr->value;
+    }
+    return PassShared(ptr, depth - 1) + 1;
+}
+
+[[gnu::noinline]] int PassBorrowed(BorrowedPtr<Payload, AtomicRefCount, false> ptr, int depth) {
+    if (depth == 0) {
+        return ptr->value;
+    }
+    return PassBorrowed(ptr, depth - 1) + 1;
+}
+
+}  // namespace
+
+void CallChainShared(benchmark::State& state) {
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(PassShared(kShared, kCallDepth));
+    }
+}
+
+void CallChainBorrowed(benchmark::State& state) {
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(PassBorrowed(kShared, kCallDepth));
+    }
+}
+
+// The last callee keeps a reference after all
+void CallChainBorrowedToShared(benchmark::State& state) {
+    BorrowedPtr<Payload, AtomicRefCount, false> borrowed = kShared;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(PassBorrowed(borrowed, kCallDepth));
+        auto kept = borrowed.ToShared();
+        benchmark::DoNotOptimize(kept);
+    }
+}
+
+BENCHMARK(CallChainShared);
+BENCHMARK(CallChainBorrowed);
+BENCHMARK(CallChainBorrowedToShared);
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// One-word handles: copying a graph's worth of them
+
+namespace {
+
+constexpr size_t kHandles = 1 << 12;
+
+template <class Ptr, class Make>
+void CopyHandles(benchmark::State& state, Make make) {
+    std::vector<Ptr> handles;
+    for (size_t i = 0; i < kHandles; ++i) {
+        handles.push_back(make());
+    }
+    for (auto _ : state) {
+        auto copy = handles;
+        benchmark::DoNotOptimize(copy.data());
+    }
+    state.SetItemsProcessed(state.iterations() * kHandles);
+}
+
+}  // namespace
+
+void SharedPtrCopyCompact(benchmark::State& state) {
+    static const auto kCompact = MakeCompactShared<Payload>();
+    CopyDestroy(state, kCompact);
+}
+
+void HandlesCopyShared(benchmark::State& state) {
+    CopyHandles<SharedPtr<Payload>>(state, [] { return MakeShared<Payload>(); });
+}
+
+void HandlesCopyCompact(benchmark::State& state) {
+    CopyHandles<CompactSharedPtr<Payload>>(state, [] { return MakeCompactShared<Payload>(); });
+}
+
+BENCHMARK(SharedPtrCopyCompact);
+BENCHMARK(HandlesCopyShared);
+BENCHMARK(HandlesCopyCompact);
+
+BENCHMARK_MAIN();
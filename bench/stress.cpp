@@ -0,0 +1,44 @@
+#include <shared-from-this/biased_ref_count.h>
+#include <shared-from-this/packed_ref_count.h>
+#include <stress/workload.h>
+
+#include <benchmark/benchmark.h>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Scalability report: the stress test's random mix, in operations per second of all the threads
+// together. Run with `--benchmark_counters_tabular=true` for one table per pointer type
+
+namespace {
+
+constexpr size_t kPoolSize = 64;
+constexpr size_t kOpsPerIteration = 256;
+
+template <class Workload>
+void RunMix(benchmark::State& state, Workload& workload) {
+    const auto seed = static_cast<uint64_t>(state.thread_index()) + 1;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(workload.Run(kOpsPerIteration, seed).locks);
+    }
+    state.SetItemsProcessed(state.iterations() * kOpsPerIteration);
+}
+
+}  // namespace
+
+// The pools live until the end of the program and are shared by all the runs
+template <class RefCount>
+void StressShared(benchmark::State& state) {
+    static stress::SharedWorkload<RefCount> workload(kPoolSize);
+    RunMix(state, workload);
+}
+
+void StressIntrusive(benchmark::State& state) {
+    static stress::IntrusiveWorkload workload(kPoolSize);
+    RunMix(state, workload);
+}
+
+BENCHMARK(StressShared<AtomicRefCount>)->ThreadRange(1, 64)->UseRealTime();
+BENCHMARK(StressShared<PackedRefCount>)->ThreadRange(1, 64)->UseRealTime();
+BENCHMARK(StressShared<BiasedRefCount>)->ThreadRange(1, 64)->UseRealTime();
+BENCHMARK(StressIntrusive)->ThreadRange(1, 64)->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,193 @@
+#include <shared-from-this/arena.h>
+#include <shared-from-this/deferred_destroy.h>
+#include <shared-from-this/releaser.h>
+#include <shared-from-this/shared.h>
+
+#include <benchmark/benchmark.h>
+
+#include <map>
+#include <memory>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Destroy path only: every element holds the last reference, the vector is filled untimed
+
+namespace {
+
+struct Payload {
+    int value = 0;
+};
+
+template <class Ptr, class Make>
+void Teardown(benchmark::State& state, Make make) {
+    const auto size = static_cast<size_t>(state.range(0));
+    for (auto _ : state) {
+        state.PauseTiming();
+        std::vector<Ptr> pointers;
+        pointers.reserve(size);
+        for (size_t i = 0; i < size; ++i) {
+            pointers.push_back(make());
+        }
+        state.ResumeTiming();
+
+        pointers.clear();
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+}  // namespace
+
+void TeardownMakeShared(benchmark::State& state) {
+    Teardown<SharedPtr<Payload>>(state, [] { return MakeShared<Payload>(); });
+}
+
+void TeardownRawPointer(benchmark::State& state) {
+    Teardown<SharedPtr<Payload>>(state, [] { return SharedPtr<Payload>(new Payload); });
+}
+
+void TeardownStdMakeShared(benchmark::State& state) {
+    Teardown<std::shared_ptr<Payload>>(state, [] { return std::make_shared<Payload>(); });
+}
+
+void TeardownStdRawPointer(benchmark::State& state) {
+    Teardown<std::shared_ptr<Payload>>(state, [] { return std::shared_ptr<Payload>(new Payload); });
+}
+
+BENCHMARK(TeardownMakeShared)->Range(1 << 10, 1 << 16);
+BENCHMARK(TeardownRawPointer)->Range(1 << 10, 1 << 16);
+BENCHMARK(TeardownStdMakeShared)->Range(1 << 10, 1 << 16);
+BENCHMARK(TeardownStdRawPointer)->Range(1 << 10, 1 << 16);
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// `SharedPtrReleaser`: the whole teardown in one batch, and the part left on the request thread
+// when the flush goes elsewhere
+
+namespace {
+
+template <bool kTimeFlush>
+void TeardownReleaser(benchmark::State& state) {
+    const auto size = static_cast<size_t>(state.range(0));
+    SharedPtrReleaser<> releaser(size);
+    for (auto _ : state) {
+        state.PauseTiming();
+        std::vector<SharedPtr<Payload>> pointers;
+        pointers.reserve(size);
+        for (size_t i = 0; i < size; ++i) {
+            pointers.push_back(MakeShared<Payload>());
+        }
+        state.ResumeTiming();
+
+        for (auto& pointer : pointers) {
+            releaser.Add(std::move(pointer));
+        }
+        pointers.clear();
+        if constexpr (!kTimeFlush) {
+            state.PauseTiming();
+        }
+        releaser.Flush();
+        if constexpr (!kTimeFlush) {
+            state.ResumeTiming();
+        }
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+}  // namespace
+
+void TeardownReleaserFlush(benchmark::State& state) {
+    TeardownReleaser<true>(state);
+}
+
+void TeardownReleaserDeferred(benchmark::State& state) {
+    TeardownReleaser<false>(state);
+}
+
+BENCHMARK(TeardownReleaserFlush)->Range(1 << 10, 1 << 16);
+BENCHMARK(TeardownReleaserDeferred)->Range(1 << 10, 1 << 16);
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// The last release of an object that is slow to destroy, as seen by the releasing thread
+
+namespace {
+
+using Map = std::map<int, int>;
+
+template <class Make>
+void ReleaseExpensive(benchmark::State& state, Make make) {
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto ptr = make();
+        for (int i = 0; i < state.range(0); ++i) {
+            ptr->emplace(i, i);
+        }
+        state.ResumeTiming();
+
+        ptr.Reset();
+
+        state.PauseTiming();
+        DefaultReclaimer().Flush();
+        state.ResumeTiming();
+    }
+}
+
+}  // namespace
+
+void ReleaseExpensiveInline(benchmark::State& state) {
+    ReleaseExpensive(state, [] { return MakeShared<Map>(); });
+}
+
+void ReleaseExpensiveDeferred(benchmark::State& state) {
+    ReleaseExpensive(state, [] { return MakeSharedDeferred<Map>(); });
+}
+
+BENCHMARK(ReleaseExpensiveInline)->Arg(1 << 10)->Arg(1 << 14);
+BENCHMARK(ReleaseExpensiveDeferred)->Arg(1 << 10)->Arg(1 << 14);
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// A request graph built and dropped as a whole: `MakeShared` per node vs one arena
+
+namespace {
+
+struct GraphNode {
+    int value = 0;
+    SharedPtr<GraphNode> shared_next;
+    GraphNode* next = nullptr;
+};
+
+}  // namespace
+
+void RequestGraphMakeShared(benchmark::State& state) {
+    const auto size = state.range(0);
+    for (auto _ : state) {
+        auto root = MakeShared<GraphNode>();
+        auto last = root.Get();
+        for (int64_t i = 1; i < size; ++i) {
+            last->shared_next = MakeShared<GraphNode>();
+            last = last->shared_next.Get();
+        }
+        benchmark::DoNotOptimize(root.Get());
+    }
+    state.SetItemsProcessed(state.iterations() * size);
+}
+
+void RequestGraphArena(benchmark::State& state) {
+    const auto size = state.range(0);
+    for (auto _ : state) {
+        SharedPtrArena<> arena;
+        auto root = arena.MakeShared<GraphNode>();
+        auto last = root.Get();
+        for (int64_t i = 1; i < size; ++i) {
+            last->next = arena.New<GraphNode>();
+            last = last->next;
+        }
+        benchmark::DoNotOptimize(root.Get());
+    }
+    state.SetItemsProcessed(state.iterations() * size);
+}
+
+BENCHMARK(RequestGraphMakeShared)->Arg(16)->Arg(256);
+BENCHMARK(RequestGraphArena)->Arg(16)->Arg(256);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,106 @@
+#include "allocations.h"
+
+#include <unique/huge_pages.h>
+#include <unique/unique.h>
+#include <unique/unique_array.h>
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <memory>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+template <class Ptr>
+void Move(benchmark::State& state, Ptr ptr) {
+    AllocationsPerIteration allocs(state);
+    for (auto _ : state) {
+        Ptr other = std::move(ptr);
+        benchmark::DoNotOptimize(other);
+        ptr = std::move(other);
+    }
+}
+
+void UniquePtrMove(benchmark::State& state) {
+    Move(state, UniquePtr<int>(new int(42)));
+}
+
+void StdUniquePtrMove(benchmark::State& state) {
+    Move(state, std::make_unique<int>(42));
+}
+
+// Every iteration deletes the previous object and takes a new one
+void UniquePtrReset(benchmark::State& state) {
+    AllocationsPerIteration allocs(state);
+    UniquePtr<int> ptr;
+    for (auto _ : state) {
+        ptr.Reset(new int(42));
+        benchmark::DoNotOptimize(ptr.Get());
+    }
+}
+
+void StdUniquePtrReset(benchmark::State& state) {
+    AllocationsPerIteration allocs(state);
+    std::unique_ptr<int> ptr;
+    for (auto _ : state) {
+        ptr.reset(new int(42));
+        benchmark::DoNotOptimize(ptr.get());
+    }
+}
+
+BENCHMARK(UniquePtrMove);
+BENCHMARK(StdUniquePtrMove);
+BENCHMARK(UniquePtrReset);
+BENCHMARK(StdUniquePtrReset);
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Random reads over a buffer much bigger than the TLB reach of 4 KiB pages
+
+namespace {
+
+constexpr size_t kBufferSize = (size_t{128} << 20) / sizeof(uint32_t);
+
+template <class Buffer>
+void RandomReads(benchmark::State& state, const Buffer& buffer) {
+    for (size_t i = 0; i < kBufferSize; ++i) {
+        buffer[i] = 0;  // fault all the pages in
+    }
+    // The next index depends on the loaded value, so every read waits for the previous one
+    uint32_t index = 0;
+    for (auto _ : state) {
+        index = index * 1664525u + 1013904223u + buffer[index % kBufferSize];
+        benchmark::DoNotOptimize(index);
+    }
+}
+
+}  // namespace
+
+void RandomReadsRegularPages(benchmark::State& state) {
+    RandomReads(state, MakeUniqueForOverwrite<uint32_t[]>(kBufferSize));
+}
+
+void RandomReadsHugePages(benchmark::State& state) {
+    RandomReads(state, MakeUniqueHugePages<uint32_t[]>(kBufferSize));
+}
+
+BENCHMARK(RandomReadsRegularPages);
+BENCHMARK(RandomReadsHugePages);
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// The length travels with the buffer, so the loop is a plain pointer range the compiler vectorizes
+
+void UniqueArraySum(benchmark::State& state) {
+    auto array = MakeUniqueArray<uint32_t>(state.range(0));
+    for (auto _ : state) {
+        uint32_t sum = 0;
+        for (auto value : array) {
+            sum += value;
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetBytesProcessed(state.iterations() * state.range(0) * sizeof(uint32_t));
+}
+
+BENCHMARK(UniqueArraySum)->Arg(1 << 12);
+
+BENCHMARK_MAIN();
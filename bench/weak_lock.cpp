@@ -0,0 +1,46 @@
+#include <shared-from-this/shared.h>
+#include <shared-from-this/weak.h>
+
+#include <benchmark/benchmark.h>
+
+#include <memory>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// All threads lock the same weak pointer, so the strong counter is the only contended word
+
+namespace {
+
+const auto kShared = MakeShared<int>(42);
+const WeakPtr<int> kWeak(kShared);
+
+const auto kStdShared = std::make_shared<int>(42);
+const std::weak_ptr<int> kStdWeak(kStdShared);
+
+}  // namespace
+
+void WeakPtrLock(benchmark::State& state) {
+    for (auto _ : state) {
+        auto locked = kWeak.Lock();
+        benchmark::DoNotOptimize(locked.Get());
+    }
+}
+
+void WeakPtrTryLock(benchmark::State& state) {
+    SharedPtr<int> locked;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(kWeak.TryLock(locked));
+    }
+}
+
+void StdWeakPtrLock(benchmark::State& state) {
+    for (auto _ : state) {
+        auto locked = kStdWeak.lock();
+        benchmark::DoNotOptimize(locked.get());
+    }
+}
+
+BENCHMARK(WeakPtrLock)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK(WeakPtrTryLock)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK(StdWeakPtrLock)->ThreadRange(1, 8)->UseRealTime();
+
+BENCHMARK_MAIN();
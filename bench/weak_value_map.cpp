@@ -0,0 +1,138 @@
+#include <shared-from-this/shared.h>
+#include <shared-from-this/weak.h>
+#include <shared-from-this/weak_value_map.h>
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// A cache of `range(0)` live objects: `WeakValueMap` against `std::unordered_map` of `WeakPtr`-s
+
+namespace {
+
+struct Payload {
+    int64_t value = 0;
+};
+
+using StdMap = std::unordered_map<int64_t, WeakPtr<Payload>>;
+
+struct Cache {
+    std::vector<SharedPtr<Payload>> owners;
+    std::vector<int64_t> keys;  // looked up in this order, hits and misses alike
+};
+
+// Keys are sparse so that half of the lookups miss; the objects are shuffled over the heap
+Cache MakeCache(size_t size) {
+    Cache cache;
+    std::mt19937_64 random(42);
+    for (size_t i = 0; i < size; ++i) {
+        cache.owners.push_back(MakeShared<Payload>(Payload{static_cast<int64_t>(i)}));
+    }
+    std::shuffle(cache.owners.begin(), cache.owners.end(), random);
+    for (size_t i = 0; i < 4096; ++i) {
+        cache.keys.push_back(static_cast<int64_t>(random() % (2 * size)));
+    }
+    return cache;
+}
+
+template <class F>
+void Lookups(benchmark::State& state, const Cache& cache, F find) {
+    for (auto _ : state) {
+        for (auto key : cache.keys) {
+            auto found = find(key);
+            benchmark::DoNotOptimize(found.Get());
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(cache.keys.size()));
+}
+
+}  // namespace
+
+void LookupWeakValueMap(benchmark::State& state) {
+    auto cache = MakeCache(static_cast<size_t>(state.range(0)));
+    WeakValueMap<int64_t, Payload> map;
+    for (const auto& owner : cache.owners) {
+        map.Insert(owner->value, owner);
+    }
+    Lookups(state, cache, [&](int64_t key) { return map.Find(key); });
+}
+
+void LookupStdMap(benchmark::State& state) {
+    auto cache = MakeCache(static_cast<size_t>(state.range(0)));
+    StdMap map;
+    for (const auto& owner : cache.owners) {
+        map.emplace(owner->value, owner);
+    }
+    Lookups(state, cache, [&](int64_t key) {
+        auto it = map.find(key);
+        return it == map.end() ? SharedPtr<Payload>() : it->second.Lock();
+    });
+}
+
+void LookupFindAll(benchmark::State& state) {
+    auto cache = MakeCache(static_cast<size_t>(state.range(0)));
+    WeakValueMap<int64_t, Payload> map;
+    for (const auto& owner : cache.owners) {
+        map.Insert(owner->value, owner);
+    }
+    std::vector<SharedPtr<Payload>> out(64);
+    for (auto _ : state) {
+        for (size_t i = 0; i < cache.keys.size(); i += out.size()) {
+            map.FindAll(std::span(cache.keys).subspan(i, out.size()), out);
+            benchmark::DoNotOptimize(out.data());
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(cache.keys.size()));
+}
+
+BENCHMARK(LookupWeakValueMap)->Range(1 << 8, 1 << 18);
+BENCHMARK(LookupStdMap)->Range(1 << 8, 1 << 18);
+BENCHMARK(LookupFindAll)->Range(1 << 8, 1 << 18);
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Churn: every key is new and its object dies soon after. The std map keeps every dead entry and
+// its control block, `WeakValueMap` stays the size of what's alive. `entries` is the map's size
+
+namespace {
+
+constexpr size_t kAlive = 256;
+
+template <class Insert, class Size>
+void Churn(benchmark::State& state, Insert insert, Size size) {
+    std::vector<SharedPtr<Payload>> alive(kAlive);
+    int64_t key = 0;
+    for (auto _ : state) {
+        auto value = MakeShared<Payload>(Payload{key});
+        insert(key, value);
+        alive[static_cast<size_t>(key) % kAlive] = std::move(value);
+        ++key;
+    }
+    state.counters["entries"] = static_cast<double>(size());
+    state.SetItemsProcessed(state.iterations());
+}
+
+}  // namespace
+
+void ChurnWeakValueMap(benchmark::State& state) {
+    WeakValueMap<int64_t, Payload> map;
+    Churn(
+        state, [&](int64_t key, const SharedPtr<Payload>& value) { map.Insert(key, value); },
+        [&] { return map.Size(); });
+}
+
+void ChurnStdMap(benchmark::State& state) {
+    StdMap map;
+    Churn(
+        state, [&](int64_t key, const SharedPtr<Payload>& value) { map.emplace(key, value); },
+        [&] { return map.size(); });
+}
+
+BENCHMARK(ChurnWeakValueMap);
+BENCHMARK(ChurnStdMap);
+
+BENCHMARK_MAIN();
@@ -46,7 +46,12 @@ endfunction()
 function(add_benchmark TARGET)
     add_hse_test_binary(${TARGET} ${ARGN})
 
-    target_link_libraries(${TARGET} benchmark)
+    target_link_libraries(${TARGET} benchmark::benchmark Threads::Threads)
+
+    # Numbers from an unoptimized build are meaningless
+    if (NOT CMAKE_BUILD_TYPE)
+        target_compile_options(${TARGET} PRIVATE -O2 -DNDEBUG)
+    endif ()
 endfunction()
 
 add_custom_target(test-all)
@@ -0,0 +1,355 @@
+#pragma once
+
+#include <intrusive/intrusive.h>
+#include <shared-from-this/shared.h>
+#include <unique/unique.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <utility>
+
+// Counters of how pointers are used, for a program built with the instrumented policies below:
+//
+//     template <class T>
+//     using Shared = SharedPtr<T, InstrumentedRefCount<>>;
+//
+//     struct Node : RefCounted<Node, InstrumentedCounter<>> { ... };
+//     UniquePtr<Buffer, InstrumentedDelete<Buffer>> buffer(new Buffer);
+//
+//     auto stats = PointerStats::Collect();
+//
+// The default policies don't report anything, so code that doesn't opt in is compiled exactly as
+// before. Each thread writes only its own counters, `Collect()` sums them up.
+class PointerStats {
+public:
+    enum class Kind { kShared, kIntrusive, kUnique };
+
+    static constexpr size_t kKinds = 3;
+
+    // Bucket `i` counts lifetimes of [2^(i - 1), 2^i) nanoseconds, the last one everything longer
+    static constexpr size_t kLifetimeBuckets = 40;
+
+    struct Counters {
+        size_t copies = 0;            // new strong references to an existing object
+        size_t lock_attempts = 0;     // `WeakPtr::Lock` on a non-empty pointer
+        size_t lock_failures = 0;     // ... which found the object already gone
+        size_t inline_blocks = 0;     // `MakeShared`-like: the object inside the control block
+        size_t separate_blocks = 0;   // `SharedPtr(new T)`: the block allocated on its own
+        size_t destroyed = 0;         // objects whose last owner has gone
+        size_t peak_use_count = 0;    // the largest count seen by a copy or a lock
+        std::array<size_t, kLifetimeBuckets> lifetimes{};
+    };
+
+    struct Snapshot {
+        std::array<Counters, kKinds> kinds;
+
+        const Counters& operator[](Kind kind) const noexcept {
+            return kinds[static_cast<size_t>(kind)];
+        }
+    };
+
+    static Snapshot Collect() {
+        std::lock_guard guard(Registry().mutex);
+        auto snapshot = Registry().exited;
+        for (auto shard = Registry().shards; shard != nullptr; shard = shard->next) {
+            shard->AddTo(snapshot);
+        }
+        return snapshot;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Hooks for the policies
+
+    static void OnCopy(Kind kind, size_t use_count) noexcept {
+        auto& counters = Local().kinds[static_cast<size_t>(kind)];
+        Increment(counters.copies);
+        UpdatePeak(counters, use_count);
+    }
+
+    // `use_count` after a successful lock
+    static void OnLock(Kind kind, bool success, size_t use_count) noexcept {
+        auto& counters = Local().kinds[static_cast<size_t>(kind)];
+        Increment(counters.lock_attempts);
+        if (success) {
+            UpdatePeak(counters, use_count);
+        } else {
+            Increment(counters.lock_failures);
+        }
+    }
+
+    static void OnNewBlock(Kind kind, bool object_inline) noexcept {
+        auto& counters = Local().kinds[static_cast<size_t>(kind)];
+        Increment(object_inline ? counters.inline_blocks : counters.separate_blocks);
+    }
+
+    static void OnDestroy(Kind kind, int64_t created) noexcept {
+        auto& counters = Local().kinds[static_cast<size_t>(kind)];
+        Increment(counters.destroyed);
+        auto lifetime = static_cast<uint64_t>(std::max<int64_t>(Now() - created, 0));
+        auto bucket = std::min<size_t>(std::bit_width(lifetime), kLifetimeBuckets - 1);
+        Increment(counters.lifetimes[bucket]);
+    }
+
+    static int64_t Now() noexcept {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    }
+
+private:
+    // Written by its thread only, so plain load + store is enough, the atomics are for `Collect`
+    struct ShardCounters {
+        std::atomic<size_t> copies = 0;
+        std::atomic<size_t> lock_attempts = 0;
+        std::atomic<size_t> lock_failures = 0;
+        std::atomic<size_t> inline_blocks = 0;
+        std::atomic<size_t> separate_blocks = 0;
+        std::atomic<size_t> destroyed = 0;
+        std::atomic<size_t> peak_use_count = 0;
+        std::array<std::atomic<size_t>, kLifetimeBuckets> lifetimes{};
+    };
+
+    struct Shard {
+        std::array<ShardCounters, kKinds> kinds;
+        Shard* prev = nullptr;
+        Shard* next = nullptr;
+
+        Shard() {
+            std::lock_guard guard(Registry().mutex);
+            next = std::exchange(Registry().shards, this);
+            if (next != nullptr) {
+                next->prev = this;
+            }
+        }
+
+        // The counts of a finished thread stay in the totals
+        ~Shard() {
+            std::lock_guard guard(Registry().mutex);
+            AddTo(Registry().exited);
+            (prev != nullptr ? prev->next : Registry().shards) = next;
+            if (next != nullptr) {
+                next->prev = prev;
+            }
+        }
+
+        void AddTo(Snapshot& snapshot) const noexcept {
+            for (size_t kind = 0; kind < kKinds; ++kind) {
+                const auto& from = kinds[kind];
+                auto& to = snapshot.kinds[kind];
+                to.copies += from.copies.load(std::memory_order_relaxed);
+                to.lock_attempts += from.lock_attempts.load(std::memory_order_relaxed);
+                to.lock_failures += from.lock_failures.load(std::memory_order_relaxed);
+                to.inline_blocks += from.inline_blocks.load(std::memory_order_relaxed);
+                to.separate_blocks += from.separate_blocks.load(std::memory_order_relaxed);
+                to.destroyed += from.destroyed.load(std::memory_order_relaxed);
+                to.peak_use_count = std::max(to.peak_use_count,
+                                             from.peak_use_count.load(std::memory_order_relaxed));
+                for (size_t i = 0; i < kLifetimeBuckets; ++i) {
+                    to.lifetimes[i] += from.lifetimes[i].load(std::memory_order_relaxed);
+                }
+            }
+        }
+    };
+
+    struct RegistryData {
+        std::mutex mutex;
+        Shard* shards = nullptr;
+        Snapshot exited;
+    };
+
+    // Never destroyed: threads may exit after the static destructors have run
+    static RegistryData& Registry() {
+        static auto registry = new RegistryData;
+        return *registry;
+    }
+
+    static Shard& Local() {
+        thread_local Shard shard;
+        return shard;
+    }
+
+    static void Increment(std::atomic<size_t>& counter) noexcept {
+        counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    static void UpdatePeak(ShardCounters& counters, size_t use_count) noexcept {
+        if (use_count > counters.peak_use_count.load(std::memory_order_relaxed)) {
+            counters.peak_use_count.store(use_count, std::memory_order_relaxed);
+        }
+    }
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// `SharedPtr` and `WeakPtr`: a counting policy which reports to `PointerStats` and forwards the
+// counting itself to `RefCount`. A policy which finishes releases later, like `BiasedRefCount`,
+// gets this wrapper's own finisher, which reports the destruction before passing it on
+
+template <class RefCount = AtomicRefCount>
+class InstrumentedRefCount {
+private:
+    using Finisher = void (*)(void*) noexcept;
+
+    static constexpr auto kKind = PointerStats::Kind::kShared;
+    static constexpr bool kDefers = requires(RefCount& ref_count, void* block, Finisher finish) {
+        ref_count.ReleaseStrong(block, finish);
+    };
+
+    // The block and its finisher are the same on every release, so racing stores are harmless.
+    // The inner policy publishes them along with the release it defers
+    struct Deferred {
+        std::atomic<void*> block = nullptr;
+        std::atomic<Finisher> finish = nullptr;
+    };
+    struct NotDeferred {};
+
+    RefCount ref_count_;
+    int64_t created_ = PointerStats::Now();
+    [[no_unique_address]] std::conditional_t<kDefers, Deferred, NotDeferred> deferred_;
+
+    static void FinishRelease(void* self) noexcept {
+        auto counts = static_cast<InstrumentedRefCount*>(self);
+        PointerStats::OnDestroy(kKind, counts->created_);
+        auto finish = counts->deferred_.finish.load(std::memory_order_relaxed);
+        finish(counts->deferred_.block.load(std::memory_order_relaxed));
+    }
+
+public:
+    size_t StrongCount() const noexcept {
+        return ref_count_.StrongCount();
+    }
+
+    size_t WeakCount() const noexcept {
+        return ref_count_.WeakCount();
+    }
+
+    void AddStrong() noexcept {
+        ref_count_.AddStrong();
+        PointerStats::OnCopy(kKind, ref_count_.StrongCount());
+    }
+
+    void AddWeak() noexcept {
+        ref_count_.AddWeak();
+    }
+
+    bool TryAddStrong() noexcept {
+        auto success = ref_count_.TryAddStrong();
+        PointerStats::OnLock(kKind, success, success ? ref_count_.StrongCount() : 0);
+        return success;
+    }
+
+    bool ReleaseStrong() noexcept
+        requires(!kDefers)
+    {
+        if (!ref_count_.ReleaseStrong()) {
+            return false;
+        }
+        PointerStats::OnDestroy(kKind, created_);
+        return true;
+    }
+
+    bool ReleaseStrong(void* block, Finisher finish) noexcept
+        requires kDefers
+    {
+        deferred_.block.store(block, std::memory_order_relaxed);
+        deferred_.finish.store(finish, std::memory_order_relaxed);
+        if (!ref_count_.ReleaseStrong(this, &FinishRelease)) {
+            return false;
+        }
+        PointerStats::OnDestroy(kKind, created_);
+        return true;
+    }
+
+    bool IsLastWeak() const noexcept {
+        return ref_count_.IsLastWeak();
+    }
+
+    bool ReleaseWeak() noexcept {
+        return ref_count_.ReleaseWeak();
+    }
+
+    // Called by `SharedPtr` for every new block
+    static void OnNewBlock(bool object_inline) noexcept {
+        PointerStats::OnNewBlock(kKind, object_inline);
+    }
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// `IntrusivePtr`: a `Counter` for `RefCounted`
+
+template <class Counter = AtomicCounter>
+class InstrumentedCounter {
+private:
+    static constexpr auto kKind = PointerStats::Kind::kIntrusive;
+
+    Counter counter_;
+    int64_t created_ = PointerStats::Now();
+
+public:
+    InstrumentedCounter() noexcept = default;
+
+    // Copying the object starts a new one with its own count
+    InstrumentedCounter([[maybe_unused]] const InstrumentedCounter& other) noexcept
+        : InstrumentedCounter() {
+    }
+
+    InstrumentedCounter& operator=([[maybe_unused]] const InstrumentedCounter& other) noexcept {
+        return *this;
+    }
+
+    size_t IncRef() {
+        auto count = counter_.IncRef();
+        if (count > 1) {  // the first one adopts the new object
+            PointerStats::OnCopy(kKind, count);
+        }
+        return count;
+    }
+
+    size_t DecRef() {
+        auto count = counter_.DecRef();
+        if (count == 0) {
+            PointerStats::OnDestroy(kKind, created_);
+        }
+        return count;
+    }
+
+    size_t RefCount() const {
+        return counter_.RefCount();
+    }
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// `UniquePtr`: a `Deleter` which reports the lifetimes. The clock starts with the deleter and
+// again after each deletion, i.e. for the object a `Reset` puts in
+
+template <class T, class Deleter = Slug<T>>
+class InstrumentedDelete {
+private:
+    template <class U, class D>
+    friend class InstrumentedDelete;
+
+    [[no_unique_address]] Deleter deleter_;
+    int64_t created_ = PointerStats::Now();
+
+public:
+    InstrumentedDelete() noexcept = default;
+
+    explicit InstrumentedDelete(Deleter deleter) noexcept : deleter_(std::move(deleter)) {
+    }
+
+    template <class U, class D>
+    InstrumentedDelete(InstrumentedDelete<U, D>&& other) noexcept
+        : deleter_(std::move(other.deleter_)), created_(other.created_) {
+    }
+
+    template <class U>
+    void operator()(U* ptr) noexcept {
+        deleter_(ptr);
+        PointerStats::OnDestroy(PointerStats::Kind::kUnique, created_);
+        created_ = PointerStats::Now();
+    }
+};
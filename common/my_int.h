@@ -1,9 +1,11 @@
 #pragma once
 
+#include <atomic>
+
 class MyInt {
 public:
     static int AliveCount() {
-        return count_alive;
+        return count_alive.load();
     }
 
     MyInt() {
@@ -39,5 +41,6 @@ public:
 private:
     int value_ = 0;
 
-    inline static int count_alive = 0;
+    // Atomic: the stress test creates and destroys objects on many threads
+    inline static std::atomic<int> count_alive = 0;
 };
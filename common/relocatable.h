@@ -0,0 +1,18 @@
+#pragma once
+
+#include <type_traits>
+
+// A type is trivially relocatable if moving an object to a new address and destroying the old one
+// can be done by copying its bytes and forgetting the old ones. The pointers qualify: none of them
+// is pointed to by anything, so `RelocatingVector` (common/relocating_vector.h) grows an array of
+// them with `realloc` instead of moving and destroying every element.
+//
+// Trivially copyable types are relocatable as they are, other types opt in by specializing:
+//
+//     template <>
+//     struct IsTriviallyRelocatable<Handle> : std::true_type {};
+template <class T>
+struct IsTriviallyRelocatable : std::bool_constant<std::is_trivially_copyable_v<T>> {};
+
+template <class T>
+concept TriviallyRelocatable = IsTriviallyRelocatable<std::remove_cv_t<T>>::value;
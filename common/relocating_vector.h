@@ -0,0 +1,196 @@
+#pragma once
+
+#include "relocatable.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// A vector which grows with `realloc` when `T` is trivially relocatable (common/relocatable.h):
+// the elements are neither moved nor destroyed one at a time, and the allocator often extends the
+// block in place. For smart pointers this skips a null store and a branch per element on the move,
+// and the destructor's test of the moved-from one.
+//
+//     RelocatingVector<SharedPtr<Node>> nodes;
+//     nodes.Reserve(count);
+//     for (...) {
+//         nodes.EmplaceBack(MakeShared<Node>(...));
+//     }
+//
+// Other types are moved as `std::vector` moves them. The memory comes from `malloc`, so `T` can't
+// be over-aligned. Only the operations an array of handles needs are there.
+template <class T>
+class RelocatingVector {
+    static_assert(alignof(T) <= alignof(std::max_align_t), "malloc doesn't over-align");
+    static_assert(std::is_nothrow_destructible_v<T>);
+
+private:
+    T* data_ = nullptr;
+    size_t size_ = 0;
+    size_t capacity_ = 0;
+
+    static constexpr size_t kMinCapacity = 8;
+
+    void Relocate(size_t capacity) {
+        if (capacity > std::numeric_limits<size_t>::max() / sizeof(T)) {
+            throw std::bad_array_new_length();
+        }
+        if constexpr (TriviallyRelocatable<T>) {
+            auto data = std::realloc(static_cast<void*>(data_), capacity * sizeof(T));
+            if (data == nullptr) {
+                throw std::bad_alloc();
+            }
+            data_ = static_cast<T*>(data);
+        } else {
+            auto data = static_cast<T*>(std::malloc(capacity * sizeof(T)));
+            if (data == nullptr) {
+                throw std::bad_alloc();
+            }
+            size_t moved = 0;
+            try {
+                for (; moved < size_; ++moved) {
+                    std::construct_at(data + moved, std::move_if_noexcept(data_[moved]));
+                }
+            } catch (...) {
+                std::destroy_n(data, moved);
+                std::free(data);
+                throw;
+            }
+            std::destroy_n(data_, size_);
+            std::free(data_);
+            data_ = data;
+        }
+        capacity_ = capacity;
+    }
+
+    void Grow() {
+        Relocate(std::max(kMinCapacity, capacity_ * 2));
+    }
+
+public:
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Constructors
+
+    RelocatingVector() noexcept = default;
+
+    RelocatingVector(RelocatingVector&& other) noexcept
+        : data_(std::exchange(other.data_, nullptr)),
+          size_(std::exchange(other.size_, 0)),
+          capacity_(std::exchange(other.capacity_, 0)) {
+    }
+
+    RelocatingVector& operator=(RelocatingVector&& other) noexcept {
+        RelocatingVector(std::move(other)).Swap(*this);
+        return *this;
+    }
+
+    RelocatingVector(const RelocatingVector&) = delete;
+    RelocatingVector& operator=(const RelocatingVector&) = delete;
+
+    ~RelocatingVector() {
+        Clear();
+        std::free(data_);
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Modifiers
+
+    void Reserve(size_t capacity) {
+        if (capacity > capacity_) {
+            Relocate(capacity);
+        }
+    }
+
+    // `args` may refer to an element: on growth the new one is made before the array moves
+    template <class... Args>
+    T& EmplaceBack(Args&&... args) {
+        if (size_ == capacity_) {
+            T value(std::forward<Args>(args)...);
+            Grow();
+            std::construct_at(data_ + size_, std::move(value));
+        } else {
+            std::construct_at(data_ + size_, std::forward<Args>(args)...);
+        }
+        return data_[size_++];  // counted only once made, a throwing constructor leaves no hole
+    }
+
+    void PushBack(const T& value) {
+        EmplaceBack(value);
+    }
+
+    void PushBack(T&& value) {
+        EmplaceBack(std::move(value));
+    }
+
+    void PopBack() noexcept {
+        assert(size_ != 0 && "PopBack on an empty vector");
+        std::destroy_at(data_ + --size_);
+    }
+
+    void Clear() noexcept {
+        std::destroy_n(data_, size_);
+        size_ = 0;
+    }
+
+    void Swap(RelocatingVector& other) noexcept {
+        std::swap(data_, other.data_);
+        std::swap(size_, other.size_);
+        std::swap(capacity_, other.capacity_);
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Observers
+
+    T& operator[](size_t i) noexcept {
+        assert(i < size_);
+        return data_[i];
+    }
+
+    const T& operator[](size_t i) const noexcept {
+        assert(i < size_);
+        return data_[i];
+    }
+
+    T* Data() noexcept {
+        return data_;
+    }
+
+    const T* Data() const noexcept {
+        return data_;
+    }
+
+    size_t Size() const noexcept {
+        return size_;
+    }
+
+    size_t Capacity() const noexcept {
+        return capacity_;
+    }
+
+    bool Empty() const noexcept {
+        return size_ == 0;
+    }
+
+    T* begin() noexcept {
+        return data_;
+    }
+
+    T* end() noexcept {
+        return data_ + size_;
+    }
+
+    const T* begin() const noexcept {
+        return data_;
+    }
+
+    const T* end() const noexcept {
+        return data_ + size_;
+    }
+};
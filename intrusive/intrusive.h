@@ -1,5 +1,8 @@
 #pragma once
 
+#include <common/relocatable.h>
+
+#include <atomic>
 #include <cstddef>  // for std::nullptr_t
 #include <utility>  // for std::exchange / std::swap
 
@@ -30,6 +33,36 @@ private:
     size_t count_ = 0;
 };
 
+// Same contract as `SimpleCounter`, safe to share between threads
+class AtomicCounter {
+public:
+    constexpr AtomicCounter() noexcept {};
+
+    AtomicCounter([[maybe_unused]] const AtomicCounter& other) noexcept : AtomicCounter(){};
+
+    AtomicCounter& operator=([[maybe_unused]] const AtomicCounter& other) noexcept {
+        return *this;
+    };
+
+    // A new reference is made from an existing one, nothing to synchronize with
+    size_t IncRef() {
+        return count_.fetch_add(1, std::memory_order_relaxed) + 1;
+    };
+
+    // The returned value alone decides destruction, so all writes to the object made through
+    // other references happen-before its deletion
+    size_t DecRef() {
+        return count_.fetch_sub(1, std::memory_order_acq_rel) - 1;
+    };
+
+    size_t RefCount() const {
+        return count_.load(std::memory_order_relaxed);
+    };
+
+private:
+    std::atomic<size_t> count_ = 0;
+};
+
 struct DefaultDelete {
     template <typename T>
     static void Destroy(T* object) {
@@ -48,8 +81,7 @@ public:
     // Decrease reference counter.
     // Destroy object using Deleter when the last instance dies.
     void DecRef() {
-        counter_.DecRef();
-        if (counter_.RefCount() == 0) {
+        if (counter_.DecRef() == 0) {
             Deleter::Destroy(static_cast<Derived*>(this));
         }
     };
@@ -66,6 +98,16 @@ private:
 template <typename Derived, typename D = DefaultDelete>
 using SimpleRefCounted [[maybe_unused]] = RefCounted<Derived, SimpleCounter, D>;
 
+template <typename Derived, typename D = DefaultDelete>
+using ThreadSafeRefCounted [[maybe_unused]] = RefCounted<Derived, AtomicCounter, D>;
+
+// Tag for taking over a reference that is already counted, e.g. one given up by `Detach()`
+struct AdoptRef {
+    explicit AdoptRef() = default;
+};
+
+inline constexpr AdoptRef kAdoptRef{};
+
 template <typename T>
 class IntrusivePtr {
 private:
@@ -88,6 +130,10 @@ public:
         }
     };
 
+    // Doesn't increment the counter: the caller hands over its own reference
+    IntrusivePtr(T* ptr, AdoptRef) noexcept : ptr_(ptr) {
+    }
+
     template <typename Y>
     IntrusivePtr(const IntrusivePtr<Y>& other) noexcept : ptr_(other.ptr_) {
         if (ptr_ != nullptr) {
@@ -95,12 +141,9 @@ public:
         }
     }
 
+    // Moves steal the reference, the counter isn't touched
     template <typename Y>
-    IntrusivePtr(IntrusivePtr<Y>&& other) noexcept : ptr_(other.ptr_) {
-        if (ptr_ != nullptr) {
-            ptr_->IncRef();
-        }
-        other.Release();
+    IntrusivePtr(IntrusivePtr<Y>&& other) noexcept : ptr_(std::exchange(other.ptr_, nullptr)) {
     }
 
     IntrusivePtr(const IntrusivePtr& other) noexcept : ptr_(other.ptr_) {
@@ -109,11 +152,7 @@ public:
         }
     };
 
-    IntrusivePtr(IntrusivePtr&& other) noexcept : ptr_(other.ptr_) {
-        if (ptr_ != nullptr) {
-            ptr_->IncRef();
-        }
-        other.Release();
+    IntrusivePtr(IntrusivePtr&& other) noexcept : ptr_(std::exchange(other.ptr_, nullptr)) {
     };
 
     // `operator=`-s
@@ -130,15 +169,11 @@ public:
     };
 
     IntrusivePtr& operator=(IntrusivePtr&& other) noexcept {
-        if (this->ptr_ == other.ptr_) {
+        if (this == &other) {
             return *this;
         }
         this->Release();
-        ptr_ = other.ptr_;
-        if (ptr_ != nullptr) {
-            ptr_->IncRef();
-        }
-        other.Release();
+        ptr_ = std::exchange(other.ptr_, nullptr);
         return *this;
     };
 
@@ -164,6 +199,11 @@ public:
         std::swap(ptr_, other.ptr_);
     };
 
+    // Gives up ownership without decrementing the counter, see `AdoptRef`
+    [[nodiscard]] T* Detach() noexcept {
+        return std::exchange(ptr_, nullptr);
+    };
+
     // Observers
     T* Get() const {
         return ptr_;
@@ -201,6 +241,10 @@ private:
     };
 };
 
+// The count is in the object, the pointer is only its address
+template <typename T>
+struct IsTriviallyRelocatable<IntrusivePtr<T>> : std::true_type {};
+
 template <typename T, typename... Args>
 IntrusivePtr<T> MakeIntrusive(Args&&... args) {
     return IntrusivePtr<T>(new T(std::forward<Args>(args)...));
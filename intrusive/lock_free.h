@@ -0,0 +1,192 @@
+#pragma once
+
+#include "intrusive.h"
+
+#include <atomic>
+#include <cassert>
+#include <type_traits>
+#include <utility>
+
+// Lock-free containers which pass `IntrusivePtr`-s between threads. The link lives in the object,
+// so pushing and popping never allocate, and the reference a pushed pointer had is kept by the
+// container until it's popped:
+//
+//     struct Buffer : ThreadSafeRefCounted<Buffer>, LockFreeHook { ... };
+//
+//     IntrusiveMPSCQueue<Buffer> queue;
+//     queue.Push(MakeIntrusive<Buffer>());         // any thread
+//     while (auto buffer = queue.Pop()) { ... }    // the consumer thread
+//
+// An object has one hook, so it's in at most one container at a time.
+//
+// Both containers have a single consumer. That is what makes them ABA-free without tags or
+// reclamation: only the consumer unlinks nodes and drops the references the container holds. So
+// the node it reads can't be freed or pushed again, since it's still linked.
+
+// Base for objects which go into the containers. Copies of an object aren't linked anywhere
+class LockFreeHook {
+private:
+    template <class T>
+    friend class IntrusiveMPSCQueue;
+
+    template <class T>
+    friend class IntrusiveStack;
+
+    std::atomic<LockFreeHook*> lock_free_next_ = nullptr;
+
+public:
+    LockFreeHook() noexcept = default;
+
+    LockFreeHook([[maybe_unused]] const LockFreeHook& other) noexcept : LockFreeHook() {
+    }
+
+    LockFreeHook& operator=([[maybe_unused]] const LockFreeHook& other) noexcept {
+        return *this;
+    }
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Many producers, one consumer, first in first out (Vyukov's intrusive queue). `Push` is wait-free:
+// one exchange and one store. A producer which stopped between the two hides what was pushed after
+// it until it goes on, so `Pop` may come back empty before the queue is
+
+template <class T>
+class IntrusiveMPSCQueue {
+    static_assert(std::is_base_of_v<LockFreeHook, T>, "T must derive from LockFreeHook");
+
+private:
+    using Hook = LockFreeHook;
+
+    std::atomic<Hook*> head_;  // the last pushed, written by the producers
+    alignas(64) Hook* tail_;   // the next to pop, the consumer's only
+    Hook stub_;                // keeps the list non-empty
+
+    void Link(Hook* node) noexcept {
+        node->lock_free_next_.store(nullptr, std::memory_order_relaxed);
+        auto prev = head_.exchange(node, std::memory_order_acq_rel);
+        prev->lock_free_next_.store(node, std::memory_order_release);
+    }
+
+    static IntrusivePtr<T> Adopt(Hook* node) noexcept {
+        return IntrusivePtr<T>(static_cast<T*>(node), kAdoptRef);
+    }
+
+public:
+    IntrusiveMPSCQueue() noexcept : head_(&stub_), tail_(&stub_) {
+    }
+
+    IntrusiveMPSCQueue(const IntrusiveMPSCQueue&) = delete;
+    IntrusiveMPSCQueue& operator=(const IntrusiveMPSCQueue&) = delete;
+
+    // Nobody may push any more, the queued references are dropped
+    ~IntrusiveMPSCQueue() {
+        while (Pop()) {
+        }
+    }
+
+    void Push(IntrusivePtr<T> ptr) noexcept {
+        assert(ptr && "pushing an empty IntrusivePtr");
+        Link(ptr.Detach());
+    }
+
+    // Consumer only. Empty if nothing is queued or the next node isn't linked yet
+    IntrusivePtr<T> Pop() noexcept {
+        auto tail = tail_;
+        auto next = tail->lock_free_next_.load(std::memory_order_acquire);
+        if (tail == &stub_) {
+            if (next == nullptr) {
+                return {};
+            }
+            tail_ = tail = next;
+            next = next->lock_free_next_.load(std::memory_order_acquire);
+        }
+        if (next != nullptr) {
+            tail_ = next;
+            return Adopt(tail);
+        }
+        if (tail != head_.load(std::memory_order_acquire)) {
+            return {};  // a producer is between its exchange and its store
+        }
+        // `tail` is the last node: put the stub behind it, so that it can be taken
+        Link(&stub_);
+        next = tail->lock_free_next_.load(std::memory_order_acquire);
+        if (next != nullptr) {
+            tail_ = next;
+            return Adopt(tail);
+        }
+        return {};
+    }
+
+    // Consumer only
+    bool Empty() const noexcept {
+        return tail_ == &stub_ && stub_.lock_free_next_.load(std::memory_order_acquire) == nullptr;
+    }
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Many producers, one consumer, last in first out (Treiber stack). `Push` is a CAS loop on the top
+
+template <class T>
+class IntrusiveStack {
+    static_assert(std::is_base_of_v<LockFreeHook, T>, "T must derive from LockFreeHook");
+
+private:
+    using Hook = LockFreeHook;
+
+    std::atomic<Hook*> top_ = nullptr;
+
+    static IntrusivePtr<T> Adopt(Hook* node) noexcept {
+        return IntrusivePtr<T>(static_cast<T*>(node), kAdoptRef);
+    }
+
+public:
+    constexpr IntrusiveStack() noexcept = default;
+
+    IntrusiveStack(const IntrusiveStack&) = delete;
+    IntrusiveStack& operator=(const IntrusiveStack&) = delete;
+
+    ~IntrusiveStack() {
+        PopAll([](IntrusivePtr<T>) {});
+    }
+
+    void Push(IntrusivePtr<T> ptr) noexcept {
+        assert(ptr && "pushing an empty IntrusivePtr");
+        Hook* node = ptr.Detach();
+        auto top = top_.load(std::memory_order_relaxed);
+        do {
+            node->lock_free_next_.store(top, std::memory_order_relaxed);
+        } while (!top_.compare_exchange_weak(top, node, std::memory_order_release,
+                                             std::memory_order_relaxed));
+    }
+
+    // Consumer only: producers never unlink, so the `next` of the top can't change under the CAS
+    IntrusivePtr<T> Pop() noexcept {
+        auto top = top_.load(std::memory_order_acquire);
+        while (top != nullptr &&
+               !top_.compare_exchange_weak(top, top->lock_free_next_.load(std::memory_order_relaxed),
+                                           std::memory_order_acquire, std::memory_order_acquire)) {
+        }
+        if (top == nullptr) {
+            return {};
+        }
+        return Adopt(top);
+    }
+
+    // Takes everything at once and passes it to `consume`, the last pushed first. It reads only
+    // nodes it has already taken, so several threads may call it at once if none of them `Pop`-s
+    template <class F>
+    size_t PopAll(F&& consume) {
+        auto list = top_.exchange(nullptr, std::memory_order_acquire);
+        size_t count = 0;
+        while (list != nullptr) {
+            auto node = std::exchange(list, list->lock_free_next_.load(std::memory_order_relaxed));
+            consume(Adopt(node));
+            ++count;
+        }
+        return count;
+    }
+
+    bool Empty() const noexcept {
+        return top_.load(std::memory_order_relaxed) == nullptr;
+    }
+};
@@ -4,7 +4,10 @@
 
 #include "allocations_checker.h"
 
+#include <atomic>
 #include <string>
+#include <thread>
+#include <vector>
 
 ////////////////////////////////////////////////////////////////////////////////
 
@@ -386,3 +389,82 @@ TEST_CASE("Object pool") {
         REQUIRE(strs.NumInUse() == 1);
     }
 }
+
+////////////////////////////////////////////////////////////////////////////////
+
+struct SharedBuffer : public ThreadSafeRefCounted<SharedBuffer> {
+    SharedBuffer(std::atomic<int>* destroyed) : destroyed(destroyed) {
+    }
+
+    ~SharedBuffer() {
+        destroyed->fetch_add(1);
+    }
+
+    std::atomic<int>* destroyed;
+};
+
+TEST_CASE("Thread-safe counter") {
+    SECTION("Copies") {
+        AtomicCounter counter;
+        REQUIRE(counter.IncRef() == 1);
+        REQUIRE(counter.IncRef() == 2);
+        AtomicCounter copy = counter;
+        REQUIRE(copy.RefCount() == 0);
+        REQUIRE(counter.DecRef() == 1);
+        REQUIRE(counter.DecRef() == 0);
+    }
+
+    SECTION("Shared between threads") {
+        constexpr int kThreads = 4;
+        constexpr int kIterations = 10'000;
+
+        std::atomic<int> destroyed = 0;
+        auto buffer = MakeIntrusive<SharedBuffer>(&destroyed);
+        std::vector<std::thread> threads;
+        for (int i = 0; i < kThreads; ++i) {
+            threads.emplace_back([buffer] {
+                for (int j = 0; j < kIterations; ++j) {
+                    IntrusivePtr<SharedBuffer> copy = buffer;
+                    IntrusivePtr<SharedBuffer> moved = std::move(copy);
+                }
+            });
+        }
+        buffer.Reset();
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        REQUIRE(destroyed == 1);
+    }
+}
+
+TEST_CASE("Ownership transfer") {
+    SECTION("Moves don't touch the counter") {
+        auto p = MakeIntrusive<MyInt>(1);
+        auto raw = p.Get();
+        IntrusivePtr<MyInt> q = std::move(p);
+        REQUIRE(p.Get() == nullptr);
+        REQUIRE(q.Get() == raw);
+        REQUIRE(raw->RefCount() == 1);
+
+        IntrusivePtr<MyInt> r;
+        r = std::move(q);
+        REQUIRE(q.Get() == nullptr);
+        REQUIRE(raw->RefCount() == 1);
+
+        IntrusivePtr<MyInt> same = r;
+        same = std::move(r);
+        REQUIRE(r.Get() == nullptr);
+        REQUIRE(raw->RefCount() == 1);
+    }
+
+    SECTION("Detach and adopt") {
+        auto p = MakeIntrusive<MyString>("aba");
+        MyString* raw = p.Detach();
+        REQUIRE(!p);
+        REQUIRE(raw->RefCount() == 1);
+
+        EXPECT_ZERO_ALLOCATIONS(IntrusivePtr<MyString> adopted(raw, kAdoptRef);
+                                REQUIRE(adopted.UseCount() == 1));
+        REQUIRE(p.UseCount() == 0);
+    }
+}
@@ -0,0 +1,154 @@
+#include "lock_free.h"
+#include "intrusive.h"
+
+#include <catch.hpp>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+struct Message : ThreadSafeRefCounted<Message>, LockFreeHook {
+    Message(int producer, int sequence) : producer(producer), sequence(sequence) {
+        alive.fetch_add(1);
+    }
+
+    ~Message() {
+        alive.fetch_sub(1);
+    }
+
+    int producer;
+    int sequence;
+
+    inline static std::atomic<int> alive = 0;
+};
+
+constexpr int kProducers = 4;
+constexpr int kMessages = 10'000;
+
+}  // namespace
+
+TEST_CASE("IntrusiveMPSCQueue") {
+    SECTION("First in first out") {
+        IntrusiveMPSCQueue<Message> queue;
+        REQUIRE(queue.Empty());
+        REQUIRE(!queue.Pop());
+
+        auto kept = MakeIntrusive<Message>(0, 1);
+        queue.Push(kept);
+        queue.Push(MakeIntrusive<Message>(0, 2));
+        REQUIRE(kept.UseCount() == 2);  // the queue keeps the reference
+        REQUIRE(!queue.Empty());
+
+        auto first = queue.Pop();
+        REQUIRE(first.Get() == kept.Get());
+        REQUIRE(queue.Pop()->sequence == 2);
+        REQUIRE(!queue.Pop());
+        REQUIRE(queue.Empty());
+
+        queue.Push(std::move(first));  // and again, after the queue has been drained
+        REQUIRE(queue.Pop().Get() == kept.Get());
+    }
+
+    SECTION("Destructor drops the queued references") {
+        {
+            IntrusiveMPSCQueue<Message> queue;
+            for (int i = 0; i < 10; ++i) {
+                queue.Push(MakeIntrusive<Message>(0, i));
+            }
+        }
+        REQUIRE(Message::alive.load() == 0);
+    }
+
+    SECTION("Many producers") {
+        IntrusiveMPSCQueue<Message> queue;
+        std::vector<std::thread> producers;
+        for (int p = 0; p < kProducers; ++p) {
+            producers.emplace_back([&, p] {
+                for (int i = 0; i < kMessages; ++i) {
+                    queue.Push(MakeIntrusive<Message>(p, i));
+                }
+            });
+        }
+
+        std::vector<int> next(kProducers, 0);
+        int received = 0;
+        while (received < kProducers * kMessages) {
+            if (auto message = queue.Pop()) {
+                REQUIRE(message->sequence == next[message->producer]);  // each producer in order
+                ++next[message->producer];
+                ++received;
+            } else {
+                std::this_thread::yield();
+            }
+        }
+        for (auto& producer : producers) {
+            producer.join();
+        }
+        REQUIRE(queue.Empty());
+        REQUIRE(Message::alive.load() == 0);
+    }
+}
+
+TEST_CASE("IntrusiveStack") {
+    SECTION("Last in first out") {
+        IntrusiveStack<Message> stack;
+        REQUIRE(!stack.Pop());
+        for (int i = 0; i < 3; ++i) {
+            stack.Push(MakeIntrusive<Message>(0, i));
+        }
+        REQUIRE(stack.Pop()->sequence == 2);
+        REQUIRE(stack.Pop()->sequence == 1);
+        REQUIRE(stack.Pop()->sequence == 0);
+        REQUIRE(stack.Empty());
+        REQUIRE(Message::alive.load() == 0);
+    }
+
+    SECTION("PopAll") {
+        IntrusiveStack<Message> stack;
+        for (int i = 0; i < 5; ++i) {
+            stack.Push(MakeIntrusive<Message>(0, i));
+        }
+        std::vector<int> popped;
+        auto count = stack.PopAll([&](IntrusivePtr<Message> message) {
+            popped.push_back(message->sequence);
+        });
+        REQUIRE(count == 5);
+        REQUIRE(popped == std::vector<int>{4, 3, 2, 1, 0});
+        REQUIRE(stack.Empty());
+        REQUIRE(Message::alive.load() == 0);
+    }
+
+    SECTION("Many producers, pushing popped objects back") {
+        IntrusiveStack<Message> stack;
+        IntrusiveStack<Message> returned;
+        std::vector<std::thread> producers;
+        for (int p = 0; p < kProducers; ++p) {
+            producers.emplace_back([&, p] {
+                for (int i = 0; i < kMessages; ++i) {
+                    stack.Push(MakeIntrusive<Message>(p, i));
+                }
+            });
+        }
+
+        int received = 0;
+        while (received < kProducers * kMessages) {
+            if (auto message = stack.Pop()) {
+                ++received;
+                if (received % 2 == 0) {
+                    returned.Push(std::move(message));  // relinked on the other stack
+                }
+            } else {
+                std::this_thread::yield();
+            }
+        }
+        for (auto& producer : producers) {
+            producer.join();
+        }
+        REQUIRE(returned.PopAll([](IntrusivePtr<Message>) {}) == kProducers * kMessages / 2);
+        REQUIRE(Message::alive.load() == 0);
+    }
+}
@@ -0,0 +1,143 @@
+#pragma once
+
+#include "shared.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// Many objects with one reference count: they're bump-allocated from chunks owned by a single
+// control block, and every pointer handed out aliases that block. E.g. the context of a request
+// which coroutines keep alive:
+//
+//     SharedPtrArena<> arena;
+//     auto request = arena.MakeShared<Request>(id);
+//     request->user = arena.New<User>(name);   // an edge inside the graph, a plain pointer
+//     co_await Handle(request);                // copies bump the arena's one counter
+//
+// The objects are destroyed together, in the reverse order of creation, once the arena and the
+// last pointer to any of them are gone; the chunks are freed right after. Until then nothing is
+// freed, so the arena suits graphs which live and die together. Objects in the arena mustn't own
+// `SharedPtr`-s from the same arena: that's a cycle which holds the whole arena.
+//
+// Creating objects isn't thread-safe, the pointers are as thread-safe as `RefCount` makes them.
+template <class RefCount = AtomicRefCount>
+class SharedPtrArena {
+private:
+    class Storage {
+    private:
+        struct Chunk {
+            Chunk* prev;
+        };
+
+        // Destructors of the objects which have one, linked from the last created
+        struct Finalizer {
+            void (*destroy)(void*) noexcept;
+            void* object;
+            Finalizer* next;
+        };
+
+        Chunk* chunk_ = nullptr;
+        std::byte* cursor_ = nullptr;
+        std::byte* end_ = nullptr;
+        size_t chunk_size_;
+        size_t allocated_ = 0;
+        Finalizer* finalizers_ = nullptr;
+
+        void NewChunk(size_t size, size_t alignment) {
+            auto bytes = std::max(chunk_size_, sizeof(Chunk) + size + alignment);
+            auto chunk = new (::operator new(bytes)) Chunk{chunk_};
+            chunk_ = chunk;
+            cursor_ = reinterpret_cast<std::byte*>(chunk + 1);
+            end_ = reinterpret_cast<std::byte*>(chunk) + bytes;
+            chunk_size_ *= 2;
+        }
+
+    public:
+        explicit Storage(size_t chunk_size) noexcept : chunk_size_(chunk_size) {
+        }
+
+        Storage(const Storage&) = delete;
+        Storage& operator=(const Storage&) = delete;
+
+        ~Storage() {
+            for (auto finalizer = finalizers_; finalizer != nullptr; finalizer = finalizer->next) {
+                finalizer->destroy(finalizer->object);
+            }
+            while (chunk_ != nullptr) {
+                ::operator delete(std::exchange(chunk_, chunk_->prev));
+            }
+        }
+
+        void* Allocate(size_t size, size_t alignment) {
+            void* ptr = cursor_;
+            auto space = static_cast<size_t>(end_ - cursor_);
+            if (cursor_ == nullptr || std::align(alignment, size, ptr, space) == nullptr) {
+                NewChunk(size, alignment);
+                ptr = cursor_;
+                space = static_cast<size_t>(end_ - cursor_);
+                std::align(alignment, size, ptr, space);
+            }
+            cursor_ = static_cast<std::byte*>(ptr) + size;
+            allocated_ += size;
+            return ptr;
+        }
+
+        template <class T, class... Args>
+        T* New(Args&&... args) {
+            if constexpr (std::is_trivially_destructible_v<T>) {
+                return new (Allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+            } else {
+                // Allocated first: once the object exists, registering it can't fail
+                auto finalizer = static_cast<Finalizer*>(
+                    Allocate(sizeof(Finalizer), alignof(Finalizer)));
+                auto object = new (Allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+                finalizers_ = new (finalizer) Finalizer{
+                    [](void* ptr) noexcept { std::destroy_at(static_cast<T*>(ptr)); }, object,
+                    finalizers_};
+                return object;
+            }
+        }
+
+        size_t Allocated() const noexcept {
+            return allocated_;
+        }
+    };
+
+    SharedPtr<Storage, RefCount> storage_;
+
+public:
+    static constexpr size_t kDefaultChunkSize = 4096;
+
+    explicit SharedPtrArena(size_t chunk_size = kDefaultChunkSize)
+        : storage_(::MakeShared<Storage, RefCount>(chunk_size)) {
+    }
+
+    // A new object sharing the arena's reference count
+    template <class T, class... Args>
+        requires(!std::is_array_v<T>)
+    SharedPtr<T, RefCount> MakeShared(Args&&... args) {
+        auto object = storage_->template New<T>(std::forward<Args>(args)...);
+        return SharedPtr<T, RefCount>(storage_, object);
+    }
+
+    // A new object without a reference: valid as long as the arena or any of its pointers
+    template <class T, class... Args>
+        requires(!std::is_array_v<T>)
+    T* New(Args&&... args) {
+        return storage_->template New<T>(std::forward<Args>(args)...);
+    }
+
+    // Bytes taken by the objects so far, without the alignment gaps
+    size_t Allocated() const noexcept {
+        return storage_->Allocated();
+    }
+
+    // Strong references to the arena, the handle included
+    size_t UseCount() const noexcept {
+        return storage_.UseCount();
+    }
+};
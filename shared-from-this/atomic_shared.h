@@ -0,0 +1,170 @@
+#pragma once
+
+#include "shared.h"
+
+#include <atomic>
+#include <cstdint>
+#include <utility>
+
+// `SharedPtr` that can be read and replaced concurrently, loads are lock-free.
+//
+// The current value sits in a heap node, and the atomic word holds the node's address in the low
+// 48 bits and a "local" reference count in the upper 16 (split reference counting). A reader bumps
+// the local count with a single `fetch_add`, copies the `SharedPtr` out of the node and gives the
+// local reference back. A writer swaps the whole word and moves the local count it took away into
+// the node's own counter, so the node dies only when the last late reader is done with it.
+//
+// A node is never installed twice, so there is no ABA. The local count only covers loads that are
+// in flight at the same moment and wraps harmlessly when the word holds no node.
+template <class T, class RefCount = AtomicRefCount>
+class AtomicSharedPtr {
+private:
+    using Value = SharedPtr<T, RefCount>;
+
+    struct Node {
+        explicit Node(Value&& value) noexcept : value(std::move(value)) {
+        }
+
+        // Late readers give their references back here before the writer hands the local count
+        // over, so it may go negative for a while but only reaches zero once everybody is done
+        std::atomic<int64_t> refs{0};
+        Value value;
+    };
+
+    static_assert(sizeof(void*) == sizeof(uint64_t), "the local count needs 64-bit pointers");
+
+    static constexpr int kCountShift = 48;
+    static constexpr uint64_t kOne = uint64_t{1} << kCountShift;
+    static constexpr uint64_t kPointerMask = kOne - 1;
+
+    mutable std::atomic<uint64_t> word_{0};  // `Load` takes a local reference, so it's mutable
+
+public:
+    static constexpr bool kIsAlwaysLockFree = std::atomic<uint64_t>::is_always_lock_free;
+
+    constexpr AtomicSharedPtr() noexcept = default;
+
+    AtomicSharedPtr(Value value) : word_(Pack(NewNode(std::move(value)))) {
+    }
+
+    AtomicSharedPtr(const AtomicSharedPtr&) = delete;
+    AtomicSharedPtr& operator=(const AtomicSharedPtr&) = delete;
+
+    // Nobody else may access the pointer by now, so the local count is zero
+    ~AtomicSharedPtr() {
+        delete Unpack(word_.load(std::memory_order_acquire));
+    }
+
+    Value Load() const noexcept {
+        auto word = word_.fetch_add(kOne, std::memory_order_acquire);
+        auto node = Unpack(word);
+        if (node == nullptr) {
+            return {};
+        }
+        Value result = node->value;
+        ReleaseLocal(node);
+        return result;
+    }
+
+    void Store(Value desired) {
+        Exchange(std::move(desired));
+    }
+
+    Value Exchange(Value desired) {
+        auto node = NewNode(std::move(desired));
+        auto old = word_.exchange(Pack(node), std::memory_order_acq_rel);
+        return Retire(old);
+    }
+
+    // Replaces the value if it stores the same pointer as `expected`, like `operator==` does.
+    // Otherwise loads the current value into `expected`
+    bool CompareExchange(Value& expected, Value desired) {
+        Node* node = nullptr;
+        while (true) {
+            auto word = word_.fetch_add(kOne, std::memory_order_acquire);
+            auto current = Unpack(word);
+            if ((current == nullptr ? nullptr : current->value.Get()) != expected.Get()) {
+                expected = current == nullptr ? Value() : current->value;
+                if (current != nullptr) {
+                    ReleaseLocal(current);
+                }
+                delete node;
+                return false;
+            }
+
+            if (node == nullptr && desired) {
+                node = NewNode(std::move(desired));
+            }
+            // The CAS has to see the word with our own local reference in it
+            word += kOne;
+            while (Unpack(word) == current) {
+                if (word_.compare_exchange_weak(word, Pack(node), std::memory_order_acq_rel,
+                                                std::memory_order_acquire)) {
+                    if (current != nullptr) {
+                        // Hand over everybody's local references except our own
+                        DropRefs(current, static_cast<int64_t>(word >> kCountShift) - 1);
+                    }
+                    return true;
+                }
+            }
+            // Somebody replaced the node in between, the local reference now lives in its counter
+            if (current != nullptr) {
+                DropRefs(current, -1);
+            }
+        }
+    }
+
+    bool IsLockFree() const noexcept {
+        return word_.is_lock_free();
+    }
+
+private:
+    static Node* NewNode(Value&& value) {
+        return value ? new Node(std::move(value)) : nullptr;
+    }
+
+    static uint64_t Pack(Node* node) noexcept {
+        return reinterpret_cast<uint64_t>(node);
+    }
+
+    static Node* Unpack(uint64_t word) noexcept {
+        return reinterpret_cast<Node*>(word & kPointerMask);
+    }
+
+    static void DropRefs(Node* node, int64_t delta) noexcept {
+        if (node->refs.fetch_add(delta, std::memory_order_acq_rel) + delta == 0) {
+            delete node;
+        }
+    }
+
+    // Give back the reference taken by `fetch_add` in `Load`
+    void ReleaseLocal(Node* node) const noexcept {
+        auto word = word_.load(std::memory_order_relaxed);
+        while (Unpack(word) == node) {
+            if (word_.compare_exchange_weak(word, word - kOne, std::memory_order_release,
+                                            std::memory_order_relaxed)) {
+                return;
+            }
+        }
+        DropRefs(node, -1);
+    }
+
+    // Hand over the local references of the swapped out word to its node, plus one for ourselves
+    // until the value is out
+    static Value Retire(uint64_t word) noexcept {
+        auto node = Unpack(word);
+        if (node == nullptr) {
+            return {};
+        }
+        auto local = static_cast<int64_t>(word >> kCountShift);
+        Value result;
+        if (local == 0 || node->refs.fetch_add(local + 1, std::memory_order_acq_rel) + local == 0) {
+            result = std::move(node->value);  // no readers left
+            delete node;
+        } else {
+            result = node->value;
+            DropRefs(node, -1);
+        }
+        return result;
+    }
+};
@@ -0,0 +1,243 @@
+#pragma once
+
+#include "shared.h"
+
+#include <atomic>
+#include <cstdint>
+
+// Biased reference counting: the thread that created the block counts its references with plain
+// loads and stores, everybody else goes through an atomic "shared" counter.
+// Use it for objects that mostly stay on their thread but sometimes escape:
+//
+//     auto session = MakeShared<Session, BiasedRefCount>();
+//
+// The true count is `biased + shared`, so the shared part may go negative when another thread
+// drops a reference made by the owner. Then nobody but the owner knows whether the object is
+// dead: the block is queued to the owner, which merges both counters on its next slow path,
+// `ProcessQueue()` call or exit. Once the owner's own count reaches zero it merges the counters
+// for good, from then on the block behaves like `AtomicRefCount`.
+//
+// Each thread that has ever owned a biased block gets a small record which lives until the end
+// of the process: blocks may still point to it after the thread is gone.
+class BiasedRefCount {
+private:
+    using Finisher = void (*)(void*) noexcept;
+
+    struct alignas(64) Owner {
+        std::atomic<BiasedRefCount*> queue = nullptr;
+        std::atomic<bool> dead = false;
+        Owner* next = nullptr;  // in `owners_`
+    };
+
+    // `shared_` holds the count shifted by two and these flags
+    static constexpr int64_t kMerged = 1;  // `biased_` is folded in and not used any more
+    static constexpr int64_t kQueued = 2;  // waits in the owner's queue, which must finish it
+    static constexpr int kCountShift = 2;
+    static constexpr int64_t kOne = int64_t{1} << kCountShift;
+
+    Owner* owner_ = CurrentOwner();
+    std::atomic<uint32_t> biased_ = 1;  // written by the owner only, plain load + store
+    std::atomic<int64_t> shared_ = 0;
+    std::atomic<size_t> weak_ref_counter_ = 1;
+
+    // Set when the block is queued
+    BiasedRefCount* next_ = nullptr;
+    void* block_ = nullptr;
+    Finisher finish_ = nullptr;
+
+public:
+    BiasedRefCount() noexcept {
+        // Creating blocks is the owner's slow path too
+        if (owner_->queue.load(std::memory_order_relaxed) != nullptr) {
+            ProcessQueue();
+        }
+    }
+
+    BiasedRefCount(const BiasedRefCount&) = delete;
+    BiasedRefCount& operator=(const BiasedRefCount&) = delete;
+
+    // Approximate while other threads copy the pointer, like any `UseCount()`
+    size_t StrongCount() const noexcept {
+        auto shared = shared_.load(std::memory_order_acquire);
+        auto count = Count(shared);
+        if (!(shared & kMerged)) {
+            count += biased_.load(std::memory_order_relaxed);
+        }
+        return count > 0 ? static_cast<size_t>(count) : 0;
+    }
+
+    size_t WeakCount() const noexcept {
+        return weak_ref_counter_.load(std::memory_order_relaxed) - (StrongCount() != 0);
+    }
+
+    void AddStrong() noexcept {
+        if (IsBiased()) {
+            biased_.store(biased_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        } else {
+            shared_.fetch_add(kOne, std::memory_order_relaxed);
+        }
+    }
+
+    void AddWeak() noexcept {
+        weak_ref_counter_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Always goes through `shared_`: the owner's counter alone can't tell if the object is alive
+    bool TryAddStrong() noexcept {
+        auto shared = shared_.load(std::memory_order_relaxed);
+        do {
+            auto count = Count(shared);
+            if (!(shared & kMerged)) {
+                count += biased_.load(std::memory_order_acquire);
+            }
+            if (count <= 0) {
+                return false;
+            }
+        } while (!shared_.compare_exchange_weak(shared, shared + kOne, std::memory_order_acq_rel,
+                                                std::memory_order_relaxed));
+        return true;
+    }
+
+    // Returns true if the last strong reference has gone. Otherwise the release may still be
+    // finished later by calling `finish(block)`
+    bool ReleaseStrong(void* block, Finisher finish) noexcept {
+        if (IsBiased()) {
+            auto biased = biased_.load(std::memory_order_relaxed) - 1;
+            biased_.store(biased, std::memory_order_release);
+            if (biased != 0) {
+                // Other threads may have dropped the rest, this block can be destroyed here too
+                if (owner_->queue.load(std::memory_order_relaxed) != nullptr) {
+                    ProcessQueue();
+                }
+                return false;
+            }
+            auto shared = shared_.fetch_or(kMerged, std::memory_order_acq_rel);
+            ProcessQueue();
+            return Count(shared) == 0 && !(shared & kQueued);
+        }
+
+        auto shared = shared_.load(std::memory_order_relaxed);
+        int64_t desired = 0;
+        do {
+            desired = shared - kOne;
+            if (!(shared & (kMerged | kQueued)) && Count(desired) < 0) {
+                desired |= kQueued;
+            }
+        } while (!shared_.compare_exchange_weak(shared, desired, std::memory_order_acq_rel,
+                                                std::memory_order_relaxed));
+
+        if ((shared & kMerged) != 0) {
+            // A queued block is finished by whoever processes the queue
+            return Count(shared) == 1 && !(shared & kQueued);
+        }
+        if ((desired & kQueued) != 0 && !(shared & kQueued)) {
+            Enqueue(block, finish);
+        }
+        return false;
+    }
+
+    // Must be called without strong references: then no new weak ones can appear
+    bool IsLastWeak() const noexcept {
+        return weak_ref_counter_.load(std::memory_order_acquire) == 1;
+    }
+
+    bool ReleaseWeak() noexcept {
+        if (IsLastWeak()) {
+            return true;
+        }
+        return weak_ref_counter_.fetch_sub(1, std::memory_order_acq_rel) == 1;
+    }
+
+    // Merge the blocks other threads handed over to the current one
+    static void ProcessQueue() noexcept {
+        Drain(CurrentOwner());
+    }
+
+private:
+    // Arithmetic shift, the flags don't matter even for a negative count
+    static int64_t Count(int64_t shared) noexcept {
+        return shared >> kCountShift;
+    }
+
+    // Only the owner's slot is touched without atomics, so it may only be read on the owner thread
+    // or after its death
+    bool IsBiased() const noexcept {
+        return owner_ == current_owner_ && biased_.load(std::memory_order_relaxed) != 0;
+    }
+
+    void Enqueue(void* block, Finisher finish) noexcept {
+        block_ = block;
+        finish_ = finish;
+        auto owner = owner_;  // `this` may be gone as soon as it's pushed
+        next_ = owner->queue.load(std::memory_order_relaxed);
+        while (!owner->queue.compare_exchange_weak(next_, this, std::memory_order_seq_cst,
+                                                   std::memory_order_relaxed)) {
+        }
+        // Either the owner's final drain sees the block or we see that it's dead
+        if (owner->dead.load(std::memory_order_seq_cst)) {
+            Drain(owner);
+        }
+    }
+
+    static void Drain(Owner* owner) noexcept {
+        if (owner->queue.load(std::memory_order_seq_cst) == nullptr) {
+            return;
+        }
+        auto item = owner->queue.exchange(nullptr, std::memory_order_acq_rel);
+        while (item != nullptr) {
+            auto next = item->next_;
+            item->Merge();
+            item = next;
+        }
+    }
+
+    // The block may be destroyed here
+    void Merge() noexcept {
+        auto biased = static_cast<int64_t>(biased_.load(std::memory_order_acquire));
+        int64_t count = 0;
+        if (biased == 0) {  // the owner has already merged
+            count = Count(shared_.fetch_sub(kQueued, std::memory_order_acq_rel));
+        } else {
+            // Known flags: kQueued becomes kMerged
+            biased_.store(0, std::memory_order_relaxed);
+            auto delta = biased * kOne + kMerged - kQueued;
+            count = Count(shared_.fetch_add(delta, std::memory_order_acq_rel)) + biased;
+        }
+        if (count == 0) {
+            finish_(block_);
+        }
+    }
+
+    // Trivial thread-local pointer for the hot path, the guard below only marks the exit
+    inline static thread_local Owner* current_owner_ = nullptr;
+
+    // All records ever made, they live until the end of the process
+    inline static std::atomic<Owner*> owners_ = nullptr;
+
+    struct OwnerGuard {
+        Owner* owner = NewOwner();
+
+        static Owner* NewOwner() {
+            auto owner = new Owner;
+            owner->next = owners_.load(std::memory_order_relaxed);
+            while (!owners_.compare_exchange_weak(owner->next, owner, std::memory_order_release,
+                                                  std::memory_order_relaxed)) {
+            }
+            return owner;
+        }
+
+        ~OwnerGuard() {
+            owner->dead.store(true, std::memory_order_seq_cst);
+            Drain(owner);
+            current_owner_ = nullptr;
+        }
+    };
+
+    static Owner* CurrentOwner() noexcept {
+        if (current_owner_ == nullptr) {
+            thread_local OwnerGuard guard;
+            current_owner_ = guard.owner;
+        }
+        return current_owner_;
+    }
+};
@@ -0,0 +1,192 @@
+#pragma once
+
+#include "shared.h"
+#include <intrusive/intrusive.h>
+#include <unique/unique.h>
+
+#include <cassert>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+#ifdef NDEBUG
+inline constexpr bool kCheckBorrows = false;
+#else
+inline constexpr bool kCheckBorrows = true;
+#endif
+
+// A non-owning view of an object owned by a `SharedPtr`, an `IntrusivePtr` or a `UniquePtr`, for
+// passing it down a call chain without touching the counters:
+//
+//     void Draw(BorrowedPtr<const Shape> shape);
+//
+//     Draw(shape);                     // from any of the owners, two words copied
+//     cache.Put(shape.ToShared());     // the callee keeps it after all: one increment
+//
+// The caller's owner must outlive the view, temporaries are rejected. When borrowed from a
+// `SharedPtr`, checked views (the default in debug builds) hold a weak reference to the control
+// block and assert on access that the object is still there. The checked and the unchecked views
+// are different types, so code built in both modes can't silently mix them.
+template <typename T, typename RefCount = AtomicRefCount, bool kChecked = kCheckBorrows>
+class BorrowedPtr {
+private:
+    template <typename Y, typename R, bool C>
+    friend class BorrowedPtr;
+
+    using ControlBlock = IControlBlock<RefCount>;
+
+public:
+    using ElementType = std::remove_extent_t<T>;
+
+private:
+    ElementType* ptr_ = nullptr;
+    ControlBlock* cblock_ = nullptr;  // the owner's block, null if it's not a `SharedPtr`
+
+    BorrowedPtr(ElementType* ptr, ControlBlock* cblock) noexcept : ptr_(ptr), cblock_(cblock) {
+        if constexpr (kChecked) {
+            if (cblock_ != nullptr) {
+                cblock_->AddWeakRef();
+            }
+        }
+    }
+
+    void CheckAlive() const noexcept {
+        if constexpr (kChecked) {
+            assert((cblock_ == nullptr || cblock_->GetStrongRefsCount() != 0) &&
+                   "BorrowedPtr outlived its owner");
+        }
+    }
+
+public:
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Constructors
+
+    constexpr BorrowedPtr() noexcept {
+    }
+
+    constexpr BorrowedPtr(std::nullptr_t) noexcept {
+    }
+
+    template <typename Y>
+        requires std::is_convertible_v<typename SharedPtr<Y, RefCount>::ElementType*, ElementType*>
+    BorrowedPtr(const SharedPtr<Y, RefCount>& owner) noexcept
+        : BorrowedPtr(owner.ptr_, owner.cblock_) {
+    }
+
+    template <typename Y>
+        requires std::is_convertible_v<Y*, ElementType*>
+    BorrowedPtr(const IntrusivePtr<Y>& owner) noexcept : ptr_(owner.Get()) {
+    }
+
+    template <typename Y, typename Deleter>
+        requires std::is_convertible_v<Y*, ElementType*>
+    BorrowedPtr(const UniquePtr<Y, Deleter>& owner) noexcept : ptr_(owner.Get()) {
+    }
+
+    // The owner would be gone at the end of the full expression
+    template <typename Y>
+    BorrowedPtr(SharedPtr<Y, RefCount>&& owner) = delete;
+
+    template <typename Y>
+    BorrowedPtr(IntrusivePtr<Y>&& owner) = delete;
+
+    template <typename Y, typename Deleter>
+    BorrowedPtr(UniquePtr<Y, Deleter>&& owner) = delete;
+
+    // Unchecked views are trivially copyable, so they're passed in registers
+    BorrowedPtr(const BorrowedPtr& other) noexcept = default;
+
+    BorrowedPtr(const BorrowedPtr& other) noexcept
+        requires kChecked
+        : BorrowedPtr(other.ptr_, other.cblock_) {
+    }
+
+    template <typename Y>
+        requires std::is_convertible_v<Y*, ElementType*>
+    BorrowedPtr(const BorrowedPtr<Y, RefCount, kChecked>& other) noexcept
+        : BorrowedPtr(other.ptr_, other.cblock_) {
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // `operator=`-s
+
+    BorrowedPtr& operator=(const BorrowedPtr& other) noexcept = default;
+
+    BorrowedPtr& operator=(const BorrowedPtr& other) noexcept
+        requires kChecked
+    {
+        BorrowedPtr(other).Swap(*this);
+        return *this;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Destructor
+
+    ~BorrowedPtr() = default;
+
+    ~BorrowedPtr()
+        requires kChecked
+    {
+        if (cblock_ != nullptr) {
+            cblock_->RemoveWeakRef();
+        }
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Modifiers
+
+    void Swap(BorrowedPtr& other) noexcept {
+        std::swap(ptr_, other.ptr_);
+        std::swap(cblock_, other.cblock_);
+    }
+
+    // A new owner sharing the block of the one borrowed from; empty if that wasn't a `SharedPtr`
+    SharedPtr<T, RefCount> ToShared() const noexcept {
+        CheckAlive();
+        SharedPtr<T, RefCount> result;
+        if (cblock_ != nullptr) {
+            cblock_->AddStrongRef();
+            result.ptr_ = ptr_;
+            result.cblock_ = cblock_;
+        }
+        return result;
+    }
+
+    // For objects which carry their own counter
+    IntrusivePtr<ElementType> ToIntrusive() const noexcept
+        requires requires(ElementType* ptr) { ptr->IncRef(); }
+    {
+        CheckAlive();
+        return IntrusivePtr<ElementType>(ptr_);
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Observers
+
+    ElementType* Get() const noexcept {
+        CheckAlive();
+        return ptr_;
+    }
+
+    ElementType& operator*() const noexcept {
+        return *Get();
+    }
+
+    ElementType* operator->() const noexcept {
+        return Get();
+    }
+
+    explicit operator bool() const noexcept {
+        return ptr_ != nullptr;
+    }
+};
+
+template <typename T, typename R>
+BorrowedPtr(const SharedPtr<T, R>&) -> BorrowedPtr<T, R>;
+
+template <typename T>
+BorrowedPtr(const IntrusivePtr<T>&) -> BorrowedPtr<T>;
+
+template <typename T, typename D>
+BorrowedPtr(const UniquePtr<T, D>&) -> BorrowedPtr<T>;
+
@@ -0,0 +1,167 @@
+#pragma once
+
+#include "sw_fwd.h"  // Forward declaration
+#include "shared.h"
+#include "weak.h"
+
+#include <cassert>
+#include <cstddef>  // std::nullptr_t
+#include <type_traits>
+#include <utility>
+
+// A `SharedPtr` of one word for objects made by `MakeCompactShared`. The object always sits at a
+// fixed offset in its `ControlBlockHolder`, so only the block is stored and the address of the
+// object is computed from it:
+//
+//     std::vector<CompactSharedPtr<Node>> edges;  // 8 handles per cache line instead of 4
+//     edges.push_back(MakeCompactShared<Node>(id));
+//
+// The price is that the pointer can't alias or point to a base: it always owns exactly a `T`.
+// `WeakPtr`-s are made from it as from a `SharedPtr`, and it converts to a `SharedPtr` with the
+// same block, e.g. to be passed to code which takes those.
+template <typename T, typename RefCount>
+class CompactSharedPtr {
+    static_assert(!std::is_array_v<T>, "arrays keep their size in the block, use SharedPtr");
+
+private:
+    template <typename Y, typename R>
+    friend class WeakPtr;
+
+    using Block = ControlBlockHolder<T, RefCount, CompactLayout>;
+
+    Block* cblock_ = nullptr;
+
+    explicit CompactSharedPtr(Block* cblock) noexcept : cblock_(cblock) {
+    }
+
+    template <class Y, class R, class... Args>
+    friend CompactSharedPtr<Y, R> MakeCompactShared(Args&&... args);
+
+    // Takes over the only reference of a pointer just made by `MakeShared`
+    static CompactSharedPtr Adopt(SharedPtr<T, RefCount>&& ptr) noexcept {
+        auto block = static_cast<Block*>(std::exchange(ptr.cblock_, nullptr));
+        ptr.ptr_ = nullptr;
+        return CompactSharedPtr(block);
+    }
+
+public:
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Constructors
+
+    constexpr CompactSharedPtr() noexcept {
+    }
+
+    constexpr CompactSharedPtr(std::nullptr_t) noexcept {
+    }
+
+    CompactSharedPtr(const CompactSharedPtr& other) noexcept : cblock_(other.cblock_) {
+        if (cblock_ != nullptr) {
+            cblock_->AddStrongRef();
+        }
+    }
+
+    CompactSharedPtr(CompactSharedPtr&& other) noexcept
+        : cblock_(std::exchange(other.cblock_, nullptr)) {
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // `operator=`-s
+
+    CompactSharedPtr& operator=(const CompactSharedPtr& other) noexcept {
+        CompactSharedPtr(other).Swap(*this);
+        return *this;
+    }
+
+    CompactSharedPtr& operator=(CompactSharedPtr&& other) noexcept {
+        CompactSharedPtr(std::move(other)).Swap(*this);
+        return *this;
+    }
+
+    CompactSharedPtr& operator=(std::nullptr_t) noexcept {
+        Reset();
+        return *this;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Destructor
+
+    ~CompactSharedPtr() {
+        if (cblock_ != nullptr) {
+            cblock_->RemoveStrongRef();
+        }
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Modifiers
+
+    void Reset() noexcept {
+        CompactSharedPtr().Swap(*this);
+    }
+
+    void Swap(CompactSharedPtr& other) noexcept {
+        std::swap(cblock_, other.cblock_);
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Conversions
+
+    // Another owner of the same block
+    operator SharedPtr<T, RefCount>() const& noexcept {
+        auto copy = *this;
+        return copy;  // moved, the && conversion below
+    }
+
+    // Hands the reference over, the counters aren't touched
+    operator SharedPtr<T, RefCount>() && noexcept {
+        SharedPtr<T, RefCount> result;
+        if (cblock_ != nullptr) {
+            result.ptr_ = cblock_->GetPtr();
+            result.cblock_ = std::exchange(cblock_, nullptr);
+        }
+        return result;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Observers
+
+    T* Get() const noexcept {
+        return cblock_ != nullptr ? cblock_->GetPtr() : nullptr;
+    }
+
+    // No null check, the object is at a constant offset from the block
+    T& operator*() const noexcept {
+        assert(cblock_ != nullptr && "dereferencing an empty CompactSharedPtr");
+        return *cblock_->GetPtr();
+    }
+
+    T* operator->() const noexcept {
+        assert(cblock_ != nullptr && "dereferencing an empty CompactSharedPtr");
+        return cblock_->GetPtr();
+    }
+
+    size_t UseCount() const noexcept {
+        if (cblock_ != nullptr) {
+            return cblock_->GetStrongRefsCount();
+        }
+        return 0;
+    }
+
+    explicit operator bool() const noexcept {
+        return cblock_ != nullptr;
+    }
+};
+
+template <typename T, typename RefCount>
+struct IsTriviallyRelocatable<CompactSharedPtr<T, RefCount>> : std::true_type {};
+
+template <typename T, typename U, typename R>
+inline bool operator==(const CompactSharedPtr<T, R>& left, const CompactSharedPtr<U, R>& right) {
+    return left.Get() == right.Get();
+}
+
+// Goes through `MakeShared`, so `EnableSharedFromThis` and the policy hooks see a usual block
+template <class T, class RefCount = AtomicRefCount, class... Args>
+CompactSharedPtr<T, RefCount> MakeCompactShared(Args&&... args) {
+    return CompactSharedPtr<T, RefCount>::Adopt(
+        MakeShared<T, RefCount, CompactLayout>(std::forward<Args>(args)...));
+}
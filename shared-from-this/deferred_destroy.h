@@ -0,0 +1,247 @@
+#pragma once
+
+#include "shared.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+// A dedicated thread which destroys objects handed over by other threads. Producers push onto a
+// lock-free stack and wake the thread only when it was empty, the thread takes the whole stack at
+// once and runs it in the order it was filled.
+//
+// The reclaimer must outlive every object that may still be queued to it.
+class Reclaimer {
+public:
+    // Base of everything that can be queued, the reclaimer calls `run` on its thread
+    class Task {
+    private:
+        friend class Reclaimer;
+
+        Task* next_ = nullptr;
+        std::chrono::steady_clock::time_point enqueued_;
+        void (*run_)(Task*) noexcept;
+
+    protected:
+        explicit Task(void (*run)(Task*) noexcept) noexcept : run_(run) {
+        }
+
+        ~Task() = default;
+    };
+
+    struct Stats {
+        size_t queued = 0;     // waiting or being destroyed right now
+        size_t reclaimed = 0;  // since the start
+        std::chrono::nanoseconds max_latency{0};  // from `Enqueue` to the end of the destruction
+        std::chrono::nanoseconds total_latency{0};
+    };
+
+    Reclaimer() : thread_([this] { Run(); }) {
+    }
+
+    Reclaimer(const Reclaimer&) = delete;
+    Reclaimer& operator=(const Reclaimer&) = delete;
+
+    // Everything queued so far is still destroyed
+    ~Reclaimer() {
+        stop_.store(true, std::memory_order_release);
+        Wake();
+        thread_.join();
+    }
+
+    void Enqueue(Task* task) noexcept {
+        task->enqueued_ = std::chrono::steady_clock::now();
+        enqueued_.fetch_add(1, std::memory_order_relaxed);
+        auto next = head_.load(std::memory_order_relaxed);
+        do {
+            task->next_ = next;  // `task` belongs to the reclaimer as soon as it's pushed
+        } while (!head_.compare_exchange_weak(next, task, std::memory_order_release,
+                                              std::memory_order_relaxed));
+        if (next == nullptr) {  // the thread may be asleep
+            Wake();
+        }
+    }
+
+    // Wait until everything queued before the call is destroyed
+    void Flush() noexcept {
+        const auto target = enqueued_.load(std::memory_order_relaxed);
+        auto reclaimed = reclaimed_.load(std::memory_order_acquire);
+        while (reclaimed < target) {
+            reclaimed_.wait(reclaimed, std::memory_order_acquire);
+            reclaimed = reclaimed_.load(std::memory_order_acquire);
+        }
+    }
+
+    Stats GetStats() const noexcept {
+        Stats stats;
+        stats.reclaimed = reclaimed_.load(std::memory_order_acquire);
+        stats.queued = enqueued_.load(std::memory_order_relaxed) - stats.reclaimed;
+        stats.max_latency = std::chrono::nanoseconds(max_latency_.load(std::memory_order_relaxed));
+        stats.total_latency =
+            std::chrono::nanoseconds(total_latency_.load(std::memory_order_relaxed));
+        return stats;
+    }
+
+private:
+    void Wake() noexcept {
+        signal_.fetch_add(1, std::memory_order_release);
+        signal_.notify_one();
+    }
+
+    void Run() noexcept {
+        while (true) {
+            // Read before taking the stack: a push onto the empty stack after it changes `signal_`
+            auto signal = signal_.load(std::memory_order_acquire);
+            auto list = head_.exchange(nullptr, std::memory_order_acquire);
+            if (list != nullptr) {
+                RunList(Reverse(list));
+            } else if (stop_.load(std::memory_order_acquire)) {
+                return;
+            } else {
+                signal_.wait(signal, std::memory_order_acquire);
+            }
+        }
+    }
+
+    static Task* Reverse(Task* list) noexcept {
+        Task* reversed = nullptr;
+        while (list != nullptr) {
+            auto next = std::exchange(list->next_, reversed);
+            reversed = std::exchange(list, next);
+        }
+        return reversed;
+    }
+
+    // Only this thread writes the latencies
+    void RunList(Task* list) noexcept {
+        while (list != nullptr) {
+            auto task = std::exchange(list, list->next_);
+            auto enqueued = task->enqueued_;
+            task->run_(task);
+
+            auto latency = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                               std::chrono::steady_clock::now() - enqueued)
+                               .count();
+            auto max_latency = max_latency_.load(std::memory_order_relaxed);
+            max_latency_.store(std::max(max_latency, latency), std::memory_order_relaxed);
+            total_latency_.store(total_latency_.load(std::memory_order_relaxed) + latency,
+                                 std::memory_order_relaxed);
+            reclaimed_.fetch_add(1, std::memory_order_release);
+            reclaimed_.notify_all();
+        }
+    }
+
+    std::atomic<Task*> head_ = nullptr;
+    std::atomic<uint32_t> signal_ = 0;
+    std::atomic<bool> stop_ = false;
+    std::atomic<size_t> enqueued_ = 0;
+    std::atomic<size_t> reclaimed_ = 0;
+    std::atomic<int64_t> max_latency_ = 0;
+    std::atomic<int64_t> total_latency_ = 0;
+    std::thread thread_;  // last: starts once the rest is ready
+};
+
+inline Reclaimer& DefaultReclaimer() {
+    static Reclaimer reclaimer;
+    return reclaimer;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Deferred destruction for `SharedPtr`-s. The counters are touched by the reclaimer thread, so the
+// policy has to be thread-safe
+
+// `MakeShared` whose object is destroyed on `DefaultReclaimer()`. Until then the queued block holds
+// a weak reference, so the memory goes away with the last of it and the `WeakPtr`-s
+template <class T, class RefCount>
+class ControlBlockDeferredHolder final : public IControlBlock<RefCount>, Reclaimer::Task {
+    static_assert(!std::is_same_v<RefCount, SingleThreadedRefCount>,
+                  "the reclaimer thread updates the counters");
+
+private:
+    using Base = IControlBlock<RefCount>;
+    using typename Base::Operation;
+
+    std::aligned_storage_t<sizeof(T), alignof(T)> storage_;
+
+    static void Manage(Base* base, Operation operation) noexcept {
+        auto self = static_cast<ControlBlockDeferredHolder*>(base);
+        switch (operation) {
+            case Operation::kDispose:
+                self->AddWeakRef();  // the caller drops the common one right after
+                DefaultReclaimer().Enqueue(self);
+                break;
+            case Operation::kDisposeAndDestroy:
+                DefaultReclaimer().Enqueue(self);  // takes over the last weak reference
+                break;
+            case Operation::kDestroy:
+                delete self;
+                break;
+        }
+    }
+
+    static void Reclaim(Reclaimer::Task* task) noexcept {
+        auto self = static_cast<ControlBlockDeferredHolder*>(task);
+        std::destroy_at(std::launder(self->GetPtr()));
+        self->RemoveWeakRef();
+    }
+
+public:
+    template <class... Args>
+    ControlBlockDeferredHolder(Args&&... args) : Base(&Manage), Task(&Reclaim) {
+        new (&storage_) T(std::forward<Args>(args)...);  // NO_LINT
+    }
+
+    T* GetPtr() {
+        return reinterpret_cast<T*>(&storage_);
+    }
+};
+
+template <class T, class RefCount = AtomicRefCount, class... Args>
+    requires(!std::is_array_v<T>)
+SharedPtr<T, RefCount> MakeSharedDeferred(Args&&... args) {
+    return SharedPtr<T, RefCount>(
+        new ControlBlockDeferredHolder<T, RefCount>(std::forward<Args>(args)...));
+}
+
+// Deleter for `SharedPtr(ptr, deleter)` which passes the object and `Deleter` to a reclaimer.
+// The queue node is allocated up front, so the release itself never allocates
+template <class T, class Deleter = Slug<T>>
+class DeferredDelete {
+private:
+    struct Node final : Reclaimer::Task {
+        explicit Node(Deleter deleter) noexcept : Task(&Run), deleter(std::move(deleter)) {
+        }
+
+        static void Run(Reclaimer::Task* task) noexcept {
+            auto self = static_cast<Node*>(task);
+            self->deleter(self->ptr);
+            delete self;
+        }
+
+        T* ptr = nullptr;
+        Deleter deleter;
+    };
+
+    Reclaimer* reclaimer_;
+    std::unique_ptr<Node> node_;
+
+public:
+    explicit DeferredDelete(Deleter deleter = Deleter(),
+                            Reclaimer& reclaimer = DefaultReclaimer())
+        : reclaimer_(&reclaimer), node_(new Node(std::move(deleter))) {
+    }
+
+    DeferredDelete(DeferredDelete&&) noexcept = default;
+    DeferredDelete& operator=(DeferredDelete&&) noexcept = default;
+
+    // A deleter is used once
+    void operator()(T* ptr) noexcept {
+        node_->ptr = ptr;
+        reclaimer_->Enqueue(node_.release());
+    }
+};
@@ -0,0 +1,275 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Hazard pointers: a reader announces the address it's about to dereference, and a writer frees
+// what it replaced only once no announcement mentions it. Reading a protected object touches
+// nothing but the reader's own slot, unlike copying a `SharedPtr`, which bounces the control
+// block's cache line between all the reading cores.
+//
+// Slots are never freed before the domain and are reused by later `HazardPtr`-s. Taking a slot
+// scans the list, so hot readers should keep a `HazardPtr` around and call `Protect` on it.
+class HazardDomain {
+public:
+    // Base of everything that can be retired, the domain calls `reclaim` once it's safe
+    class Retired {
+    private:
+        friend class HazardDomain;
+
+        const void* address_ = nullptr;
+        Retired* next_ = nullptr;
+        void (*reclaim_)(Retired*) noexcept;
+
+    protected:
+        explicit Retired(void (*reclaim)(Retired*) noexcept) noexcept : reclaim_(reclaim) {
+        }
+
+        ~Retired() = default;
+    };
+
+    constexpr HazardDomain() noexcept = default;
+
+    HazardDomain(const HazardDomain&) = delete;
+    HazardDomain& operator=(const HazardDomain&) = delete;
+
+    // Nobody may read through the domain any more
+    ~HazardDomain() {
+        ReclaimAll(retired_.exchange(nullptr, std::memory_order_acquire));
+        auto slot = slots_.load(std::memory_order_acquire);
+        while (slot != nullptr) {
+            delete std::exchange(slot, slot->next);
+        }
+    }
+
+    // The object must already be unreachable for new readers
+    template <class T>
+        requires std::is_base_of_v<Retired, T>
+    void Retire(T* object) noexcept {
+        object->address_ = object;
+        Push(object, object);
+        if (retired_count_.fetch_add(1, std::memory_order_relaxed) + 1 >= ReclaimThreshold()) {
+            Reclaim();
+        }
+    }
+
+    // Free everything retired that isn't protected right now
+    void Reclaim() noexcept {
+        auto list = retired_.exchange(nullptr, std::memory_order_acquire);
+        if (list == nullptr) {
+            return;
+        }
+        std::vector<const void*> hazards;
+        try {
+            hazards.reserve(slots_count_.load(std::memory_order_relaxed));
+            for (auto slot = slots_.load(std::memory_order_acquire); slot != nullptr;
+                 slot = slot->next) {
+                // Ordered after the writer's exchange, so a reader either sees the new value or
+                // its slot is seen here
+                if (auto pointer = slot->pointer.load(std::memory_order_seq_cst)) {
+                    hazards.push_back(pointer);
+                }
+            }
+        } catch (...) {
+            PushList(list);  // try again on the next retire
+            return;
+        }
+        std::sort(hazards.begin(), hazards.end());
+
+        Retired* keep = nullptr;
+        Retired* keep_tail = nullptr;
+        size_t freed = 0;
+        while (list != nullptr) {
+            auto item = std::exchange(list, list->next_);
+            if (std::binary_search(hazards.begin(), hazards.end(), item->address_)) {
+                item->next_ = keep;
+                keep = item;
+                keep_tail = keep_tail == nullptr ? item : keep_tail;
+            } else {
+                item->reclaim_(item);
+                ++freed;
+            }
+        }
+        retired_count_.fetch_sub(freed, std::memory_order_relaxed);
+        if (keep != nullptr) {
+            Push(keep, keep_tail);
+        }
+    }
+
+    size_t RetiredCount() const noexcept {
+        return retired_count_.load(std::memory_order_relaxed);
+    }
+
+private:
+    friend class HazardPtr;
+
+    struct alignas(64) Slot {  // one per cache line, readers never share them
+        std::atomic<const void*> pointer = nullptr;
+        std::atomic<bool> active = true;
+        Slot* next = nullptr;
+    };
+
+    static constexpr size_t kMinReclaimThreshold = 64;
+
+    size_t ReclaimThreshold() const noexcept {
+        return std::max(kMinReclaimThreshold, 2 * slots_count_.load(std::memory_order_relaxed));
+    }
+
+    Slot* AcquireSlot() {
+        for (auto slot = slots_.load(std::memory_order_acquire); slot != nullptr;
+             slot = slot->next) {
+            if (!slot->active.load(std::memory_order_relaxed) &&
+                !slot->active.exchange(true, std::memory_order_acquire)) {
+                return slot;
+            }
+        }
+        auto slot = new Slot;
+        slot->next = slots_.load(std::memory_order_relaxed);
+        while (!slots_.compare_exchange_weak(slot->next, slot, std::memory_order_release,
+                                             std::memory_order_relaxed)) {
+        }
+        slots_count_.fetch_add(1, std::memory_order_relaxed);
+        return slot;
+    }
+
+    static void ReleaseSlot(Slot* slot) noexcept {
+        slot->pointer.store(nullptr, std::memory_order_release);
+        slot->active.store(false, std::memory_order_release);
+    }
+
+    void Push(Retired* head, Retired* tail) noexcept {
+        tail->next_ = retired_.load(std::memory_order_relaxed);
+        while (!retired_.compare_exchange_weak(tail->next_, head, std::memory_order_release,
+                                               std::memory_order_relaxed)) {
+        }
+    }
+
+    void PushList(Retired* list) noexcept {
+        auto tail = list;
+        while (tail->next_ != nullptr) {
+            tail = tail->next_;
+        }
+        Push(list, tail);
+    }
+
+    static void ReclaimAll(Retired* list) noexcept {
+        while (list != nullptr) {
+            auto item = std::exchange(list, list->next_);
+            item->reclaim_(item);
+        }
+    }
+
+    std::atomic<Slot*> slots_ = nullptr;
+    std::atomic<size_t> slots_count_ = 0;
+    std::atomic<Retired*> retired_ = nullptr;
+    std::atomic<size_t> retired_count_ = 0;
+};
+
+inline HazardDomain& DefaultHazardDomain() noexcept {
+    static HazardDomain domain;
+    return domain;
+}
+
+// Owns a slot of the domain, protects one pointer at a time
+class HazardPtr {
+public:
+    explicit HazardPtr(HazardDomain& domain = DefaultHazardDomain())
+        : slot_(domain.AcquireSlot()) {
+    }
+
+    HazardPtr(HazardPtr&& other) noexcept : slot_(std::exchange(other.slot_, nullptr)) {
+    }
+
+    HazardPtr& operator=(HazardPtr&& other) noexcept {
+        if (this != &other) {
+            Release();
+            slot_ = std::exchange(other.slot_, nullptr);
+        }
+        return *this;
+    }
+
+    ~HazardPtr() {
+        Release();
+    }
+
+    // Load `source` and keep the result alive until the next `Protect` or `Reset`
+    template <class T>
+    T* Protect(const std::atomic<T*>& source) noexcept {
+        auto ptr = source.load(std::memory_order_relaxed);
+        while (true) {
+            slot_->pointer.store(ptr, std::memory_order_seq_cst);  // publish before re-checking
+            auto again = source.load(std::memory_order_seq_cst);
+            if (again == ptr) {
+                return ptr;
+            }
+            ptr = again;
+        }
+    }
+
+    void Reset() noexcept {
+        slot_->pointer.store(nullptr, std::memory_order_release);
+    }
+
+private:
+    void Release() noexcept {
+        if (slot_ != nullptr) {
+            HazardDomain::ReleaseSlot(slot_);
+        }
+    }
+
+    HazardDomain::Slot* slot_;
+};
+
+// Read-mostly owner of a `SharedPtr` or an `IntrusivePtr`.
+// `Protect` reads the current object without touching its reference count, `Load` takes a real
+// reference for readers that have to keep it. Replaced values are released through the domain
+template <class Ptr>
+class ReadMostly {
+private:
+    struct Node final : HazardDomain::Retired {
+        explicit Node(Ptr value) noexcept : Retired(&Reclaim), value(std::move(value)) {
+        }
+
+        static void Reclaim(HazardDomain::Retired* self) noexcept {
+            delete static_cast<Node*>(self);
+        }
+
+        Ptr value;
+    };
+
+public:
+    using Pointer = decltype(std::declval<const Ptr&>().Get());
+
+    explicit ReadMostly(Ptr value = Ptr(), HazardDomain& domain = DefaultHazardDomain())
+        : domain_(domain), current_(new Node(std::move(value))) {
+    }
+
+    ReadMostly(const ReadMostly&) = delete;
+    ReadMostly& operator=(const ReadMostly&) = delete;
+
+    ~ReadMostly() {
+        delete current_.load(std::memory_order_acquire);
+    }
+
+    Pointer Protect(HazardPtr& hazard) const noexcept {
+        return hazard.Protect(current_)->value.Get();
+    }
+
+    Ptr Load() const {
+        HazardPtr hazard(domain_);
+        return hazard.Protect(current_)->value;
+    }
+
+    void Store(Ptr value) {
+        auto node = new Node(std::move(value));
+        domain_.Retire(current_.exchange(node, std::memory_order_seq_cst));
+    }
+
+private:
+    HazardDomain& domain_;
+    std::atomic<Node*> current_;
+};
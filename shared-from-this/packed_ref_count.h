@@ -0,0 +1,88 @@
+#pragma once
+
+#include "shared.h"
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+
+// Both counters in one 64-bit word: strong in the low half, weak in the high one. The control
+// block shrinks by 8 bytes, which matters for huge numbers of small objects:
+//
+//     auto point = MakeShared<Point, PackedRefCount>(x, y);  // 16 bytes of block header
+//
+// Over 4 billion references of one kind abort the process: the operations are noexcept, and the
+// carry would otherwise corrupt the other counter.
+class PackedRefCount {
+private:
+    static constexpr uint64_t kStrongOne = 1;
+    static constexpr uint64_t kWeakOne = uint64_t{1} << 32;
+    static constexpr uint64_t kStrongMask = kWeakOne - 1;  // also the largest count of each kind
+
+    std::atomic<uint64_t> counters_ = kStrongOne | kWeakOne;
+
+    static uint64_t Strong(uint64_t counters) noexcept {
+        return counters & kStrongMask;
+    }
+
+    static uint64_t Weak(uint64_t counters) noexcept {
+        return counters >> 32;
+    }
+
+public:
+    size_t StrongCount() const noexcept {
+        return Strong(counters_.load(std::memory_order_relaxed));
+    }
+
+    size_t WeakCount() const noexcept {
+        auto counters = counters_.load(std::memory_order_relaxed);
+        return Weak(counters) - (Strong(counters) != 0);
+    }
+
+    void AddStrong() noexcept {
+        auto counters = counters_.fetch_add(kStrongOne, std::memory_order_relaxed);
+        if (Strong(counters) == kStrongMask) [[unlikely]] {
+            std::abort();
+        }
+    }
+
+    void AddWeak() noexcept {
+        auto counters = counters_.fetch_add(kWeakOne, std::memory_order_relaxed);
+        if (Weak(counters) == kStrongMask) [[unlikely]] {
+            std::abort();
+        }
+    }
+
+    bool TryAddStrong() noexcept {
+        auto counters = counters_.load(std::memory_order_relaxed);
+        do {
+            if (Strong(counters) == 0) {
+                return false;
+            }
+            if (Strong(counters) == kStrongMask) [[unlikely]] {
+                std::abort();
+            }
+        } while (!counters_.compare_exchange_weak(counters, counters + kStrongOne,
+                                                  std::memory_order_acq_rel,
+                                                  std::memory_order_relaxed));
+        return true;
+    }
+
+    // A load first to skip the RMW for the sole owner costs more on every other release than it
+    // saves on the last one
+    bool ReleaseStrong() noexcept {
+        return Strong(counters_.fetch_sub(kStrongOne, std::memory_order_acq_rel)) == 1;
+    }
+
+    // Must be called without strong references: then no new weak ones can appear
+    bool IsLastWeak() const noexcept {
+        return Weak(counters_.load(std::memory_order_acquire)) == 1;
+    }
+
+    bool ReleaseWeak() noexcept {
+        if (IsLastWeak()) {
+            return true;
+        }
+        return Weak(counters_.fetch_sub(kWeakOne, std::memory_order_acq_rel)) == 1;
+    }
+};
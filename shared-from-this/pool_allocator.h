@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+
+// Stateless allocator with a per-thread free list of `sizeof(T)` chunks.
+// Meant for `AllocateShared`: it gets rebound to the control block type, so every block type has
+// its own lists, and once the lists are warm creating and destroying objects never reaches the
+// global allocator. A chunk freed on another thread simply joins that thread's list.
+template <class T, size_t MaxCached = 4096>
+class PoolAllocator {
+public:
+    using value_type = T;  // NOLINT: required by std::allocator_traits
+
+    template <class U>
+    struct rebind {  // NOLINT: required by std::allocator_traits
+        using other = PoolAllocator<U, MaxCached>;
+    };
+
+    constexpr PoolAllocator() noexcept = default;
+
+    template <class U>
+    constexpr PoolAllocator(const PoolAllocator<U, MaxCached>&) noexcept {
+    }
+
+    T* allocate(size_t n) {  // NOLINT: required by std::allocator_traits
+        auto& list = Local();
+        if (n == 1 && list.head != nullptr) {
+            auto chunk = list.head;
+            list.head = chunk->next;
+            --list.size;
+            return reinterpret_cast<T*>(chunk);
+        }
+        return static_cast<T*>(::operator new(n * ChunkSize()));
+    }
+
+    void deallocate(T* ptr, size_t n) noexcept {  // NOLINT: required by std::allocator_traits
+        auto& list = Local();
+        if (n == 1 && list.size < MaxCached) {
+            list.head = new (ptr) Chunk{list.head};
+            ++list.size;
+            return;
+        }
+        ::operator delete(ptr);
+    }
+
+    // Fill the current thread's list in advance, so that even the first objects are pooled
+    static void Reserve(size_t count) {
+        auto& list = Local();
+        while (list.size < count && list.size < MaxCached) {
+            auto memory = ::operator new(ChunkSize());
+            list.head = new (memory) Chunk{list.head};
+            ++list.size;
+        }
+    }
+
+    // The number of chunks cached by the current thread
+    static size_t CachedCount() noexcept {
+        return Local().size;
+    }
+
+    friend bool operator==(const PoolAllocator&, const PoolAllocator&) noexcept {
+        return true;
+    }
+
+private:
+    struct Chunk {
+        Chunk* next = nullptr;
+    };
+
+    // `T` is usually the control block which stores the allocator, so it's incomplete up here
+    static constexpr size_t ChunkSize() noexcept {
+        static_assert(alignof(T) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__,
+                      "over-aligned types aren't pooled");
+        return sizeof(T) < sizeof(Chunk) ? sizeof(Chunk) : sizeof(T);
+    }
+
+    struct FreeList {
+        Chunk* head = nullptr;
+        size_t size = 0;
+
+        ~FreeList() {
+            while (head != nullptr) {
+                auto next = head->next;
+                ::operator delete(head);
+                head = next;
+            }
+        }
+    };
+
+    static FreeList& Local() noexcept {
+        thread_local FreeList list;
+        return list;
+    }
+};
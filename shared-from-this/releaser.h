@@ -0,0 +1,96 @@
+#pragma once
+
+#include "shared.h"
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+// Takes over the references of many `SharedPtr`-s and drops them together in `Flush()`, in one
+// tight loop over the control blocks. E.g. a request context can be torn down off the request
+// thread:
+//
+//     SharedPtrReleaser<> releaser(nodes.size());
+//     for (auto& node : nodes) {
+//         releaser.Add(std::move(node));
+//     }
+//     std::thread([releaser = std::move(releaser)]() mutable { releaser.Flush(); }).detach();
+//
+// `Add` doesn't touch the block, so the objects stay alive, and lockable by `WeakPtr`-s, until the
+// flush. Destructors run in the order the pointers were added. The batch can be flushed on any
+// thread if the policy allows it; blocks from `PoolAllocator` then join the flushing thread's list.
+template <typename RefCount = AtomicRefCount>
+class SharedPtrReleaser {
+private:
+    using ControlBlock = IControlBlock<RefCount>;
+
+    // Blocks are scattered over the heap, load a few of them ahead of their destruction
+    static constexpr size_t kPrefetchDistance = 8;
+
+    std::vector<ControlBlock*> blocks_;
+
+public:
+    SharedPtrReleaser() noexcept = default;
+
+    explicit SharedPtrReleaser(size_t capacity) {
+        blocks_.reserve(capacity);
+    }
+
+    SharedPtrReleaser(SharedPtrReleaser&& other) noexcept : blocks_(std::move(other.blocks_)) {
+    }
+
+    SharedPtrReleaser& operator=(SharedPtrReleaser&& other) noexcept {
+        if (this != &other) {
+            Flush();
+            blocks_ = std::move(other.blocks_);
+        }
+        return *this;
+    }
+
+    SharedPtrReleaser(const SharedPtrReleaser&) = delete;
+    SharedPtrReleaser& operator=(const SharedPtrReleaser&) = delete;
+
+    ~SharedPtrReleaser() {
+        Flush();
+    }
+
+    // If there is no memory left to remember the block, the reference is dropped right away
+    template <typename T>
+    void Add(SharedPtr<T, RefCount>&& ptr) noexcept {
+        auto block = std::exchange(ptr.cblock_, nullptr);
+        ptr.ptr_ = nullptr;
+        if (block == nullptr) {
+            return;
+        }
+        try {
+            blocks_.push_back(block);
+        } catch (...) {
+            block->RemoveStrongRef();
+        }
+    }
+
+    void Reserve(size_t capacity) {
+        blocks_.reserve(capacity);
+    }
+
+    // Drop everything collected so far. Destructors may add more pointers, they're released in the
+    // same loop
+    void Flush() noexcept {
+        for (size_t i = 0; i < blocks_.size(); ++i) {
+            if (i + kPrefetchDistance < blocks_.size()) {
+                __builtin_prefetch(blocks_[i + kPrefetchDistance]);
+            }
+            blocks_[i]->RemoveStrongRef();
+        }
+        blocks_.clear();
+    }
+
+    // References waiting for `Flush()`
+    size_t Size() const noexcept {
+        return blocks_.size();
+    }
+
+    bool Empty() const noexcept {
+        return blocks_.empty();
+    }
+};
@@ -1,119 +1,450 @@
 #pragma once
 
 #include "sw_fwd.h"  // Forward declaration
-#include <cstddef>   // std::nullptr_t
+#include <common/relocatable.h>
+#include <unique/unique.h>
+#include <cstddef>  // std::nullptr_t
 #include <type_traits>
 #include <memory>
+#include <atomic>
+#include <algorithm>
+#include <limits>
+#include <new>
 
 class ESFTBase {};
 
-template <typename T>
+template <typename T, typename RefCount = AtomicRefCount>
 class EnableSharedFromThis;
 
+template <typename RefCount>
+class SharedPtrReleaser;
+
+template <typename T, typename RefCount, bool kChecked>
+class BorrowedPtr;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Reference counting policies
+//
+// All strong references together own one extra weak reference. It keeps the control block alive
+// while `Dispose()` runs, and lets the last owner skip the weak decrement when nobody else can see
+// the block any more.
+
+// Plain counters for objects that never leave their thread
+class SingleThreadedRefCount {
+private:
+    size_t strong_ref_counter_ = 1;
+    size_t weak_ref_counter_ = 1;
+
+public:
+    size_t StrongCount() const noexcept {
+        return strong_ref_counter_;
+    }
+
+    size_t WeakCount() const noexcept {
+        return weak_ref_counter_ - (strong_ref_counter_ != 0);
+    }
+
+    void AddStrong() noexcept {
+        ++strong_ref_counter_;
+    }
+
+    void AddWeak() noexcept {
+        ++weak_ref_counter_;
+    }
+
+    // Returns false if the object has already been disposed
+    bool TryAddStrong() noexcept {
+        if (strong_ref_counter_ == 0) {
+            return false;
+        }
+        ++strong_ref_counter_;
+        return true;
+    }
+
+    // Returns true if the last strong reference has gone
+    bool ReleaseStrong() noexcept {
+        return --strong_ref_counter_ == 0;
+    }
+
+    // Only the reference of the strong owners is left
+    bool IsLastWeak() const noexcept {
+        return weak_ref_counter_ == 1;
+    }
+
+    // Returns true if the control block has to be destroyed
+    bool ReleaseWeak() noexcept {
+        return --weak_ref_counter_ == 0;
+    }
+};
+
+// Counters that may be touched from any thread
+class AtomicRefCount {
+private:
+    std::atomic<size_t> strong_ref_counter_ = 1;
+    std::atomic<size_t> weak_ref_counter_ = 1;
+
+public:
+    size_t StrongCount() const noexcept {
+        return strong_ref_counter_.load(std::memory_order_relaxed);
+    }
+
+    size_t WeakCount() const noexcept {
+        auto strong = strong_ref_counter_.load(std::memory_order_relaxed);
+        return weak_ref_counter_.load(std::memory_order_relaxed) - (strong != 0);
+    }
+
+    // New references are always made from existing ones, so nothing has to be ordered here
+    void AddStrong() noexcept {
+        strong_ref_counter_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void AddWeak() noexcept {
+        weak_ref_counter_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Increment if nonzero: once the strong counter has dropped to zero it never comes back
+    bool TryAddStrong() noexcept {
+        auto count = strong_ref_counter_.load(std::memory_order_relaxed);
+        do {
+            if (count == 0) {
+                return false;
+            }
+        } while (!strong_ref_counter_.compare_exchange_weak(
+            count, count + 1, std::memory_order_acq_rel, std::memory_order_relaxed));
+        return true;
+    }
+
+    // All writes to the object happen-before its disposal
+    bool ReleaseStrong() noexcept {
+        return strong_ref_counter_.fetch_sub(1, std::memory_order_acq_rel) == 1;
+    }
+
+    // Must be called without strong references: then no new weak ones can appear
+    bool IsLastWeak() const noexcept {
+        return weak_ref_counter_.load(std::memory_order_acquire) == 1;
+    }
+
+    bool ReleaseWeak() noexcept {
+        // A single weak reference without strong ones is ours: nobody can copy it concurrently
+        if (IsLastWeak()) {
+            return true;
+        }
+        return weak_ref_counter_.fetch_sub(1, std::memory_order_acq_rel) == 1;
+    }
+};
+
+// Control blocks have no vtable: the concrete block passes a single manager function instead, so
+// the final release costs one indirect call without loading a vptr first
+template <class RefCount>
 class IControlBlock {
+protected:
+    enum class Operation { kDispose, kDestroy, kDisposeAndDestroy };
+
+    using Manager = void (*)(IControlBlock*, Operation) noexcept;
+
+    explicit IControlBlock(Manager manager) noexcept : manager_(manager) {
+    }
+
+    ~IControlBlock() = default;
+
 private:
-    size_t strong_ref_counter_ = 0;
-    size_t weak_ref_counter_ = 0;
+    RefCount ref_count_;
+    Manager manager_;
 
 public:
+    IControlBlock(const IControlBlock&) = delete;
+    IControlBlock& operator=(const IControlBlock&) = delete;
+
     size_t GetStrongRefsCount() const noexcept {
-        return strong_ref_counter_;
+        return ref_count_.StrongCount();
     }
 
     void AddStrongRef() noexcept {
-        ++strong_ref_counter_;
+        ref_count_.AddStrong();
+    }
+
+    // Used by `WeakPtr` which doesn't keep the object alive
+    bool TryAddStrongRef() noexcept {
+        return ref_count_.TryAddStrong();
     }
 
+    // Dispose the object with the last strong reference, then drop their common weak one.
+    // Without weak references nobody can see the block any more, so both happen in one call
     void RemoveStrongRef() noexcept {
-        --strong_ref_counter_;
+        if (ReleaseStrong()) {
+            ReleaseLastStrong();
+        }
     }
 
     bool IsZeroStrongOwning() const noexcept {
-        return strong_ref_counter_ == 0;
+        return GetStrongRefsCount() == 0;
     }
 
     [[maybe_unused]] size_t GetWeakRefsCount() const noexcept {
-        return weak_ref_counter_;
+        return ref_count_.WeakCount();
     }
 
     void AddWeakRef() noexcept {
-        ++weak_ref_counter_;
+        ref_count_.AddWeak();
     }
 
     void RemoveWeakRef() noexcept {
-        --weak_ref_counter_;
+        if (ref_count_.ReleaseWeak()) {
+            Destroy();
+        }
     }
 
-    bool IsZeroWeakOwning() const noexcept {
-        return weak_ref_counter_ == 0;
+    void Destroy() noexcept {  // for total destroy control block
+        manager_(this, Operation::kDestroy);
     }
 
-    void Destroy() noexcept {  // for total destroy control block
-        delete this;
+    void Dispose() noexcept {  // for free memory
+        manager_(this, Operation::kDispose);
+    }
+
+private:
+    // A policy may be unable to tell right away whether the count has dropped to zero. Then it
+    // takes a callback and finishes the release later, possibly on another thread
+    bool ReleaseStrong() noexcept {
+        if constexpr (requires { ref_count_.ReleaseStrong(this, &FinishRelease); }) {
+            return ref_count_.ReleaseStrong(this, &FinishRelease);
+        } else {
+            return ref_count_.ReleaseStrong();
+        }
     }
 
-    virtual void Dispose() = 0;  // for free memory
+    static void FinishRelease(void* block) noexcept {
+        static_cast<IControlBlock*>(block)->ReleaseLastStrong();
+    }
 
-    virtual ~IControlBlock() = default;
+    void ReleaseLastStrong() noexcept {
+        if (ref_count_.IsLastWeak()) {
+            manager_(this, Operation::kDisposeAndDestroy);
+        } else {
+            Dispose();
+            RemoveWeakRef();
+        }
+    }
 };
 
-template <class T>
-class ControlBlockPtr final : public IControlBlock {
+template <class T, class RefCount, class Deleter = Slug<T>>
+class ControlBlockPtr final : public IControlBlock<RefCount> {
 private:
-    T* ptr_ = nullptr;
+    using Base = IControlBlock<RefCount>;
+    using typename Base::Operation;
+
+    CompressedPair<T*, Deleter> data_;  // First = T* ptr_, Second = Deleter deleter
+
+    static void Manage(Base* base, Operation operation) noexcept {
+        auto self = static_cast<ControlBlockPtr*>(base);
+        if (operation != Operation::kDestroy) {
+            self->data_.GetSecond()(self->data_.GetFirst());
+        }
+        if (operation != Operation::kDispose) {
+            delete self;
+        }
+    }
 
 public:
-    constexpr ControlBlockPtr() = default;  // same as ControlBlockPtr(nullptr)
+    ControlBlockPtr() noexcept : ControlBlockPtr(nullptr, Deleter()) {
+    }
+
+    explicit ControlBlockPtr(T* ptr, Deleter deleter = Deleter()) noexcept
+        : Base(&Manage), data_(ptr, std::move(deleter)) {
+    }
+};
+
+inline constexpr size_t kCacheLineSize = 64;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Layout policies: where `MakeShared` puts the object relative to the counters. The layout is a
+// property of the block, so pointers made with different layouts have the same type
+
+// Right after the counters, the smallest block
+struct CompactLayout {
+    template <class T>
+    static constexpr size_t kAlignment = alignof(T);
+};
+
+// On the cache line after the counters, the block padded to whole lines
+struct IsolatedLayout {
+    template <class T>
+    static constexpr size_t kAlignment = std::max(kCacheLineSize, alignof(T));
+};
+
+template <class T, class RefCount, class Layout = CompactLayout>
+class ControlBlockHolder final : public IControlBlock<RefCount> {
+private:
+    using Base = IControlBlock<RefCount>;
+    using typename Base::Operation;
 
-    explicit ControlBlockPtr(T* ptr) noexcept : ptr_(ptr) {
-        if (ptr_ != nullptr) {
-            IControlBlock::AddStrongRef();
+    alignas(Layout::template kAlignment<T>) std::aligned_storage_t<sizeof(T), alignof(T)> storage_;
+
+    static void Manage(Base* base, Operation operation) noexcept {
+        auto self = static_cast<ControlBlockHolder*>(base);
+        if (operation != Operation::kDestroy) {
+            std::destroy_at(std::launder(self->GetPtr()));
+        }
+        if (operation != Operation::kDispose) {
+            delete self;
         }
     }
-    void Dispose() noexcept override {
-        delete ptr_;
+
+public:
+    template <class... Args>
+    ControlBlockHolder(Args&&... args) : Base(&Manage) {
+        new (&storage_) T(std::forward<Args>(args)...);  // NO_LINT
     }
 
-    ~ControlBlockPtr() noexcept override {
+    T* GetPtr() {
+        return reinterpret_cast<T*>(&storage_);
     }
 };
 
-template <class T>
-class ControlBlockHolder final : public IControlBlock {
+// Same as `ControlBlockHolder`, but the block itself comes from `Alloc`
+template <class T, class Alloc, class RefCount>
+class ControlBlockAllocHolder final : public IControlBlock<RefCount> {
+public:
+    using Allocator =
+        typename std::allocator_traits<Alloc>::template rebind_alloc<ControlBlockAllocHolder>;
+
 private:
+    using Base = IControlBlock<RefCount>;
+    using typename Base::Operation;
+    using AllocatorTraits = std::allocator_traits<Allocator>;
+
+    [[no_unique_address]] Allocator allocator_;
     std::aligned_storage_t<sizeof(T), alignof(T)> storage_;
 
+    static void Manage(Base* base, Operation operation) noexcept {
+        auto self = static_cast<ControlBlockAllocHolder*>(base);
+        if (operation != Operation::kDestroy) {
+            std::destroy_at(std::launder(self->GetPtr()));
+        }
+        if (operation != Operation::kDispose) {
+            Allocator allocator(std::move(self->allocator_));
+            std::destroy_at(self);
+            AllocatorTraits::deallocate(allocator, self, 1);
+        }
+    }
+
 public:
     template <class... Args>
-    ControlBlockHolder(Args&&... args) {
+    ControlBlockAllocHolder(const Allocator& allocator, Args&&... args)
+        : Base(&Manage), allocator_(allocator) {
         new (&storage_) T(std::forward<Args>(args)...);  // NO_LINT
-        IControlBlock::AddStrongRef();
     }
 
     T* GetPtr() {
         return reinterpret_cast<T*>(&storage_);
     }
 
-    void Dispose() noexcept override {
-        std::destroy_at(std::launder(GetPtr()));
+    // Allocate and construct the block, nothing leaks if the constructor of `T` throws
+    template <class... Args>
+    static ControlBlockAllocHolder* Create(const Alloc& alloc, Args&&... args) {
+        Allocator allocator(alloc);
+        auto memory = AllocatorTraits::allocate(allocator, 1);
+        try {
+            return new (memory) ControlBlockAllocHolder(allocator, std::forward<Args>(args)...);
+        } catch (...) {
+            AllocatorTraits::deallocate(allocator, memory, 1);
+            throw;
+        }
     }
+};
 
-    ~ControlBlockHolder() noexcept override {
+// Counters and `size` elements in one allocation. The elements start on their own cache line, so
+// reference counting doesn't invalidate the lines readers of the data are using
+template <class T, class RefCount>
+class ControlBlockArray final : public IControlBlock<RefCount> {
+private:
+    using Base = IControlBlock<RefCount>;
+    using typename Base::Operation;
+
+    static constexpr size_t kAlignment = std::max(kCacheLineSize, alignof(T));
+
+    size_t size_;
+
+    explicit ControlBlockArray(size_t size) noexcept : Base(&Manage), size_(size) {
+    }
+
+    static constexpr size_t DataOffset() noexcept {
+        return (sizeof(ControlBlockArray) + kAlignment - 1) / kAlignment * kAlignment;
+    }
+
+    static void Free(ControlBlockArray* self) noexcept {
+        std::destroy_at(self);
+        ::operator delete(self, std::align_val_t{kAlignment});
+    }
+
+    static void Manage(Base* base, Operation operation) noexcept {
+        auto self = static_cast<ControlBlockArray*>(base);
+        if (operation != Operation::kDestroy) {
+            std::destroy_n(self->GetPtr(), self->size_);
+        }
+        if (operation != Operation::kDispose) {
+            Free(self);
+        }
+    }
+
+public:
+    // Value-initializes the elements unless `for_overwrite` is set, then they are
+    // default-initialized, i.e. left as they are for trivial types
+    static ControlBlockArray* Create(size_t size, bool for_overwrite) {
+        if (size > (std::numeric_limits<size_t>::max() - DataOffset()) / sizeof(T)) {
+            throw std::bad_array_new_length();
+        }
+        auto memory = ::operator new(DataOffset() + size * sizeof(T), std::align_val_t{kAlignment});
+        auto block = new (memory) ControlBlockArray(size);
+        try {
+            if (for_overwrite) {
+                std::uninitialized_default_construct_n(block->GetPtr(), size);
+            } else {
+                std::uninitialized_value_construct_n(block->GetPtr(), size);
+            }
+        } catch (...) {
+            Free(block);
+            throw;
+        }
+        return block;
+    }
+
+    T* GetPtr() noexcept {
+        return reinterpret_cast<T*>(reinterpret_cast<std::byte*>(this) + DataOffset());
+    }
+
+    size_t Size() const noexcept {
+        return size_;
     }
 };
 
 // https://en.cppreference.com/w/cpp/memory/shared_ptr
-template <typename T>
+template <typename T, typename RefCount>
 class SharedPtr {
 private:
-    template <typename Y>
+    template <typename Y, typename R>
     friend class SharedPtr;
 
-    template <typename Y>
+    template <typename Y, typename R>
     friend class WeakPtr;
 
-    T* ptr_ = nullptr;                 // pointer to type
-    IControlBlock* cblock_ = nullptr;  // pointer to the control block that owns the object
+    template <typename R>
+    friend class SharedPtrReleaser;
+
+    template <typename Y, typename R, bool C>
+    friend class BorrowedPtr;
+
+    template <typename Y, typename R>
+    friend class CompactSharedPtr;
+
+    using ControlBlock = IControlBlock<RefCount>;
+
+public:
+    using ElementType = std::remove_extent_t<T>;
+
+private:
+    ElementType* ptr_ = nullptr;      // pointer to type, the first element for arrays
+    ControlBlock* cblock_ = nullptr;  // pointer to the control block that owns the object
 
 public:
     ////////////////////////////////////////////////////////////////////////////////////////////////
@@ -125,81 +456,95 @@ public:
     constexpr SharedPtr(std::nullptr_t) noexcept {
     }
 
+    // Arrays are deleted with `delete[]`
     template <class Y>
-    explicit SharedPtr(Y* ptr) : ptr_(ptr), cblock_(new ControlBlockPtr<Y>(ptr)) {
+    explicit SharedPtr(Y* ptr)
+        : SharedPtr(ptr, std::conditional_t<std::is_array_v<T>, Slug<ElementType[]>, Slug<Y>>()) {
         static_assert(!std::is_void<Y>::value,
                       "Y must be a complete type");  // from ccpreference.com
         static_assert(sizeof(Y) > 0, "Y must be a complete type");
-        if constexpr (std::is_convertible_v<Y*, ESFTBase*>) {
-            ptr->weak_this_ = *this;
+    }
+
+    // The deleter lives in the same control block, empty ones take no space.
+    // If the block can't be allocated, `ptr` is deleted right away
+    template <class Y, class Deleter>
+    SharedPtr(Y* ptr, Deleter deleter) : ptr_(ptr), cblock_(NewBlock(ptr, std::move(deleter))) {
+        NoteNewBlock(false);
+        InitWeakThis(ptr);
+    }
+
+    // Takes over both the object and the deleter, the control block is the only allocation.
+    // The block is allocated before the deleter is moved into it, so if that throws, `other` still
+    // owns both, as with `std::shared_ptr`
+    template <class Y, class Deleter>
+        requires(!std::is_array_v<Y>)
+    SharedPtr(UniquePtr<Y, Deleter>&& other) {
+        if (other.Get() != nullptr) {
+            cblock_ = new ControlBlockPtr<Y, RefCount, std::decay_t<Deleter>>(
+                other.Get(), std::move(other.GetDeleter()));
+            ptr_ = other.Release();
+            NoteNewBlock(false);
+            InitWeakThis(ptr_);
         }
     }
 
-    SharedPtr(const SharedPtr<T>& other) noexcept : ptr_(other.ptr_), cblock_(other.cblock_) {
+    SharedPtr(const SharedPtr& other) noexcept : ptr_(other.ptr_), cblock_(other.cblock_) {
         if (cblock_ != nullptr) {
             cblock_->AddStrongRef();  // increment strong refs counter
         }
-        if constexpr (std::is_convertible_v<T*, ESFTBase*>) {
-            other.ptr_->weak_this_ = *this;
-        }
     }
 
     template <class Y>
-    SharedPtr(const SharedPtr<Y>& other) noexcept : ptr_(other.ptr_), cblock_(other.cblock_) {
+    SharedPtr(const SharedPtr<Y, RefCount>& other) noexcept
+        : ptr_(other.ptr_), cblock_(other.cblock_) {
         if (cblock_ != nullptr) {
             cblock_->AddStrongRef();  // increment strong refs counter
         }
-        if constexpr (std::is_convertible_v<Y*, ESFTBase*>) {
-            other.ptr_->weak_this_ = *this;
-        }
     }
 
     template <class Y>
-    SharedPtr(SharedPtr<Y>&& other) noexcept : ptr_(other.ptr_), cblock_(other.cblock_) {
-        if constexpr (std::is_convertible_v<Y*, ESFTBase*>) {
-            other.ptr_->weak_this_ = *this;
-        }
+    SharedPtr(SharedPtr<Y, RefCount>&& other) noexcept
+        : ptr_(other.ptr_), cblock_(other.cblock_) {
         other.Zeroing();
     }
 
-    // MakeShared ctor
-    template <class Y>
-    SharedPtr(ControlBlockHolder<Y>* cblock_holder) noexcept
+    // MakeShared ctor: adopts the only reference of a block which holds the object inline
+    template <class Block>
+        requires std::is_base_of_v<ControlBlock, Block>
+    explicit SharedPtr(Block* cblock_holder) noexcept
         : ptr_(cblock_holder->GetPtr()), cblock_(cblock_holder) {
-        if constexpr (std::is_convertible_v<Y*, ESFTBase*>) {
-            ptr_->weak_this_ = *this;
-        }
+        NoteNewBlock(true);
+        InitWeakThis(cblock_holder->GetPtr());
     }
 
     // Aliasing constructor
     // #8 from https://en.cppreference.com/w/cpp/memory/shared_ptr/shared_ptr
     template <typename Y>
-    SharedPtr(const SharedPtr<Y>& other, T* ptr) noexcept : ptr_(ptr), cblock_(other.cblock_) {
+    SharedPtr(const SharedPtr<Y, RefCount>& other, ElementType* ptr) noexcept
+        : ptr_(ptr), cblock_(other.cblock_) {
         if (cblock_ != nullptr) {
             cblock_->AddStrongRef();  // // increment strong refs counter
         }
     }
 
     template <typename Y>
-    SharedPtr(const SharedPtr<Y>&& other, T* ptr) noexcept : ptr_(ptr), cblock_(other.cblock_) {
+    SharedPtr(const SharedPtr<Y, RefCount>&& other, ElementType* ptr) noexcept
+        : ptr_(ptr), cblock_(other.cblock_) {
         other.Zeroing();
     }
 
     // Promote `WeakPtr`
     // #11 from https://en.cppreference.com/w/cpp/memory/shared_ptr/shared_ptr
-    explicit SharedPtr(const WeakPtr<T>& other) {
-        if (other.Expired()) {
+    explicit SharedPtr(const WeakPtr<T, RefCount>& other) {
+        if (!other.TryLock(*this)) {
             throw BadWeakPtr();
         }
-        cblock_ = other.cblock_;
-        ptr_ = other.ptr_;
-        cblock_->AddStrongRef();
     };
 
     ////////////////////////////////////////////////////////////////////////////////////////////////
     // `operator=`-s
 
-    SharedPtr& operator=(const SharedPtr<T>& other) noexcept {
+    SharedPtr& operator=(const SharedPtr& other) noexcept {
         if (this != &other) {
             this->Release();    // release old object
             ptr_ = other.ptr_;  // seizure of shared possession
@@ -211,7 +556,7 @@ public:
         return *this;
     }
 
-    SharedPtr& operator=(SharedPtr<T>&& other) noexcept {
+    SharedPtr& operator=(SharedPtr&& other) noexcept {
         if (this != &other) {
             this->Release();    // release old object
             ptr_ = other.ptr_;  // seizure of shared possession (at this moment it only this)
@@ -242,12 +587,15 @@ public:
 
     template <class Y>
     void Reset(Y* ptr) {
-        this->Release();
-        ptr_ = ptr;
-        cblock_ = new ControlBlockPtr<Y>(ptr);
+        SharedPtr(ptr).Swap(*this);
+    }
+
+    template <class Y, class Deleter>
+    void Reset(Y* ptr, Deleter deleter) {
+        SharedPtr(ptr, std::move(deleter)).Swap(*this);
     }
 
-    void Swap(SharedPtr<T>& other) noexcept {
+    void Swap(SharedPtr& other) noexcept {
         std::swap(cblock_, other.cblock_);
         std::swap(ptr_, other.ptr_);
     }
@@ -255,18 +603,28 @@ public:
     ////////////////////////////////////////////////////////////////////////////////////////////////
     // Observers
 
-    T* Get() const noexcept {
+    ElementType* Get() const noexcept {
         return ptr_;
     }
 
-    T& operator*() const noexcept {
+    T& operator*() const noexcept
+        requires(!std::is_array_v<T>)
+    {
         return *Get();
     }
 
-    T* operator->() const noexcept {
+    T* operator->() const noexcept
+        requires(!std::is_array_v<T>)
+    {
         return Get();
     }
 
+    ElementType& operator[](std::ptrdiff_t index) const noexcept
+        requires std::is_array_v<T>
+    {
+        return Get()[index];
+    }
+
     size_t UseCount() const noexcept {
         if (cblock_ != nullptr) {
             return cblock_->GetStrongRefsCount();
@@ -278,58 +636,128 @@ public:
         return Get() != nullptr;
     }
 private:
+    template <class Y, class Deleter>
+    static ControlBlock* NewBlock(Y* ptr, Deleter&& deleter) {
+        try {
+            return new ControlBlockPtr<Y, RefCount, Deleter>(ptr, std::move(deleter));
+        } catch (...) {
+            deleter(ptr);
+            throw;
+        }
+    }
+
+    // A counting policy may want to know how blocks are made, see common/instrumentation.h
+    static void NoteNewBlock(bool object_inline) noexcept {
+        if constexpr (requires { RefCount::OnNewBlock(object_inline); }) {
+            RefCount::OnNewBlock(object_inline);
+        }
+    }
+
+    // `weak_this_` is set only by the first control block that takes ownership of the object.
+    // Copies, moves and releases never touch it: it expires by itself with the last owner
+    template <class Y>
+    void InitWeakThis(Y* ptr) noexcept {
+        if constexpr (!std::is_array_v<T> && std::is_convertible_v<Y*, ESFTBase*>) {
+            if (ptr != nullptr && ptr->weak_this_.Expired()) {
+                ptr->weak_this_ = *this;
+            }
+        }
+    }
+
     void Release() noexcept {
         if (cblock_ != nullptr) {
-            if constexpr (std::is_convertible_v<T*, ESFTBase*>) {
-                if (!ptr_->weak_this_.Expired()) {
-                    ptr_->weak_this_.Reset();
-                }
-            }
             cblock_->RemoveStrongRef();  // decrement strong refs counter
-            if (cblock_->IsZeroStrongOwning()) {
-                cblock_->Dispose();
-            }
-            if (cblock_->IsZeroStrongOwning() && cblock_->IsZeroWeakOwning()) {
-                cblock_->Destroy();
-            }
         }
         this->Zeroing();
     }
 };
 
-template <class T, class U>
-inline bool operator==(const SharedPtr<T>& lhs, const SharedPtr<U>& rhs) noexcept {
+// The block counts references, it doesn't know where they are
+template <typename T, typename RefCount>
+struct IsTriviallyRelocatable<SharedPtr<T, RefCount>> : std::true_type {};
+
+template <class T, class U, class RefCount>
+inline bool operator==(const SharedPtr<T, RefCount>& lhs,
+                       const SharedPtr<U, RefCount>& rhs) noexcept {
     return lhs.Get() == rhs.Get();
 }
 
 // Allocate memory only once
-template <class T, class... Args>
-SharedPtr<T> MakeShared(Args&&... args) {
-    return SharedPtr<T>(new ControlBlockHolder<T>(std::forward<Args>(args)...));
+template <class T, class RefCount = AtomicRefCount, class Layout = CompactLayout, class... Args>
+    requires(!std::is_array_v<T>)
+SharedPtr<T, RefCount> MakeShared(Args&&... args) {
+    return SharedPtr<T, RefCount>(
+        new ControlBlockHolder<T, RefCount, Layout>(std::forward<Args>(args)...));
+}
+
+// `IsolatedLayout`: copying the pointer on one thread doesn't invalidate the object on another
+// which writes to it, for the price of a bigger block
+template <class T, class RefCount = AtomicRefCount, class... Args>
+    requires(!std::is_array_v<T>)
+SharedPtr<T, RefCount> MakeSharedIsolated(Args&&... args) {
+    return MakeShared<T, RefCount, IsolatedLayout>(std::forward<Args>(args)...);
+}
+
+// `size` value-initialized elements, in the same allocation as the counters
+template <class T, class RefCount = AtomicRefCount>
+    requires std::is_unbounded_array_v<T>
+SharedPtr<T, RefCount> MakeShared(size_t size) {
+    using Block = ControlBlockArray<std::remove_extent_t<T>, RefCount>;
+    return SharedPtr<T, RefCount>(Block::Create(size, false));
+}
+
+template <class T, class RefCount = AtomicRefCount>
+    requires std::is_bounded_array_v<T>
+SharedPtr<T, RefCount> MakeShared() {
+    using Block = ControlBlockArray<std::remove_extent_t<T>, RefCount>;
+    return SharedPtr<T, RefCount>(Block::Create(std::extent_v<T>, false));
+}
+
+// Same, but the elements are default-initialized: trivial ones keep whatever the memory holds
+template <class T, class RefCount = AtomicRefCount>
+    requires std::is_unbounded_array_v<T>
+SharedPtr<T, RefCount> MakeSharedForOverwrite(size_t size) {
+    using Block = ControlBlockArray<std::remove_extent_t<T>, RefCount>;
+    return SharedPtr<T, RefCount>(Block::Create(size, true));
+}
+
+template <class T, class RefCount = AtomicRefCount>
+    requires std::is_bounded_array_v<T>
+SharedPtr<T, RefCount> MakeSharedForOverwrite() {
+    using Block = ControlBlockArray<std::remove_extent_t<T>, RefCount>;
+    return SharedPtr<T, RefCount>(Block::Create(std::extent_v<T>, true));
+}
+
+// Same single allocation, but through a copy of `alloc` rebound to the control block type.
+// The block is returned to that allocator once the last `WeakPtr` is gone
+template <class T, class RefCount = AtomicRefCount, class Alloc, class... Args>
+SharedPtr<T, RefCount> AllocateShared(const Alloc& alloc, Args&&... args) {
+    return SharedPtr<T, RefCount>(
+        ControlBlockAllocHolder<T, Alloc, RefCount>::Create(alloc, std::forward<Args>(args)...));
 }
 
 // Look for usage examples in tests
-template <class T>
+template <class T, class RefCount>
 class EnableSharedFromThis : public ESFTBase {
 private:
-    template <typename Y>
+    template <typename Y, typename R>
     friend class SharedPtr;
 
-    WeakPtr<T> weak_this_;  // special weak pointer to itself
+    WeakPtr<T, RefCount> weak_this_;  // special weak pointer to itself
 public:
-    SharedPtr<T> SharedFromThis() {
+    SharedPtr<T, RefCount> SharedFromThis() {
         return weak_this_.Lock();
     };
 
-    [[maybe_unused]] SharedPtr<const T> SharedFromThis() const {
+    [[maybe_unused]] SharedPtr<const T, RefCount> SharedFromThis() const {
         return weak_this_.Lock();
     };
 
-    WeakPtr<T> WeakFromThis() noexcept {
+    WeakPtr<T, RefCount> WeakFromThis() noexcept {
         return weak_this_;
     };
 
-    WeakPtr<const T> WeakFromThis() const noexcept {
+    WeakPtr<const T, RefCount> WeakFromThis() const noexcept {
         return weak_this_;
     };
 };
@@ -5,8 +5,14 @@
 // Instead of std::bad_weak_ptr
 class BadWeakPtr : public std::exception {};
 
-template <typename T>
+class SingleThreadedRefCount;
+class AtomicRefCount;
+
+template <typename T, typename RefCount = AtomicRefCount>
 class SharedPtr;
 
-template <typename T>
+template <typename T, typename RefCount = AtomicRefCount>
 class WeakPtr;
+
+template <typename T, typename RefCount = AtomicRefCount>
+class CompactSharedPtr;
@@ -89,3 +89,22 @@ TEST_CASE("WeakFromThis") {
     REQUIRE(!weak.Expired());
     REQUIRE(weak.Lock().Get() == ptr);
 }
+
+TEST_CASE("Copies don't touch WeakFromThis") {
+    SharedPtr<T> first(new T);
+    auto weak = first->WeakFromThis();
+    {
+        SharedPtr<T> copy = first;
+        SharedPtr<T> moved = std::move(copy);
+        moved.Reset();
+    }
+    REQUIRE(!weak.Expired());
+    REQUIRE(first->SharedFromThis() == first);
+
+    SharedPtr<T> other(first.Get(), [](T*) {});
+    REQUIRE(other->SharedFromThis() == first);
+    other.Reset();
+
+    first.Reset();
+    REQUIRE(weak.Expired());
+}
@@ -0,0 +1,204 @@
+#include "shared.h"
+#include "weak.h"
+#include "pool_allocator.h"
+
+#include <catch.hpp>
+
+#include "allocations_checker.h"
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+struct AllocatorStats {
+    int allocated = 0;
+    int deallocated = 0;
+};
+
+template <class T>
+struct CountingAllocator {
+    using value_type = T;
+
+    explicit CountingAllocator(AllocatorStats* stats) noexcept : stats(stats) {
+    }
+
+    template <class U>
+    CountingAllocator(const CountingAllocator<U>& other) noexcept : stats(other.stats) {
+    }
+
+    T* allocate(size_t n) {
+        ++stats->allocated;
+        return std::allocator<T>().allocate(n);
+    }
+
+    void deallocate(T* ptr, size_t n) noexcept {
+        ++stats->deallocated;
+        std::allocator<T>().deallocate(ptr, n);
+    }
+
+    friend bool operator==(const CountingAllocator&, const CountingAllocator&) = default;
+
+    AllocatorStats* stats;
+};
+
+struct Throwing {
+    Throwing() {
+        throw std::runtime_error("ctor");
+    }
+};
+
+}  // namespace
+
+TEST_CASE("AllocateShared") {
+    SECTION("Default allocator") {
+        std::allocator<std::string> alloc;
+        auto sp = AllocateShared<std::string>(alloc, "aba");
+        REQUIRE(*sp == "aba");
+        REQUIRE(sp.UseCount() == 1);
+    }
+
+    SECTION("Block goes back to the allocator") {
+        AllocatorStats stats;
+        CountingAllocator<int> alloc(&stats);
+        WeakPtr<int> wp;
+        {
+            auto sp = AllocateShared<int>(alloc, 42);
+            wp = sp;
+            REQUIRE(*sp == 42);
+            REQUIRE(stats.allocated == 1);
+        }
+        REQUIRE(wp.Expired());
+        REQUIRE(stats.deallocated == 0);
+        wp.Reset();
+        REQUIRE(stats.deallocated == 1);
+    }
+
+    SECTION("Throwing constructor") {
+        AllocatorStats stats;
+        CountingAllocator<Throwing> alloc(&stats);
+        REQUIRE_THROWS_AS(AllocateShared<Throwing>(alloc), std::runtime_error);
+        REQUIRE(stats.allocated == 1);
+        REQUIRE(stats.deallocated == 1);
+    }
+
+    SECTION("Single-threaded policy") {
+        auto sp = AllocateShared<int, SingleThreadedRefCount>(std::allocator<int>(), 1);
+        REQUIRE(*sp == 1);
+    }
+}
+
+TEST_CASE("MakeSharedIsolated") {
+    static_assert(sizeof(ControlBlockHolder<int, AtomicRefCount, IsolatedLayout>) ==
+                  2 * kCacheLineSize);
+
+    SECTION("Object on its own line") {
+        SharedPtr<int> sp;
+        EXPECT_ONE_ALLOCATION(sp = MakeSharedIsolated<int>(42));
+        REQUIRE(*sp == 42);
+        REQUIRE(reinterpret_cast<uintptr_t>(sp.Get()) % kCacheLineSize == 0);
+    }
+
+    SECTION("Weak pointers") {
+        WeakPtr<std::string> wp;
+        {
+            auto sp = MakeSharedIsolated<std::string>(100, 'a');
+            wp = sp;
+            REQUIRE(wp.Lock()->size() == 100);
+        }
+        REQUIRE(wp.Expired());
+    }
+
+    SECTION("Over-aligned object") {
+        struct alignas(256) Wide {
+            int value = 0;
+        };
+        auto sp = MakeSharedIsolated<Wide>();
+        REQUIRE(reinterpret_cast<uintptr_t>(sp.Get()) % 256 == 0);
+    }
+
+    SECTION("Throwing constructor") {
+        REQUIRE_THROWS_AS(MakeSharedIsolated<Throwing>(), std::runtime_error);
+    }
+}
+
+TEST_CASE("PoolAllocator") {
+    SECTION("Zero allocations in steady state") {
+        using Pair = std::pair<int, int>;
+        PoolAllocator<Pair> alloc;
+        AllocateShared<Pair>(alloc, 1, 2);
+
+        for (int i = 0; i < 100; ++i) {
+            EXPECT_ZERO_ALLOCATIONS(AllocateShared<Pair>(alloc, i, i));
+        }
+    }
+
+    SECTION("Reserve") {
+        using Block = ControlBlockAllocHolder<int, PoolAllocator<int>, AtomicRefCount>;
+        PoolAllocator<Block>::Reserve(8);
+        REQUIRE(PoolAllocator<Block>::CachedCount() >= 8);
+
+        std::vector<SharedPtr<int>> pointers;
+        pointers.reserve(8);
+        for (int i = 0; i < 8; ++i) {
+            SharedPtr<int> sp;
+            EXPECT_ZERO_ALLOCATIONS(sp = AllocateShared<int>(PoolAllocator<int>(), i));
+            pointers.push_back(std::move(sp));
+        }
+        pointers.clear();
+        REQUIRE(PoolAllocator<Block>::CachedCount() >= 8);
+    }
+}
+
+TEST_CASE("Allocation profile") {
+    SECTION("Size classes") {
+        auto before = alloc_checker::Snapshot();
+        auto sp = MakeShared<std::array<char, 200>>();
+        auto after = alloc_checker::Snapshot();
+
+        REQUIRE(after.allocations == before.allocations + 1);
+        REQUIRE(after.allocated_bytes - before.allocated_bytes > 200);
+        size_t live = 0;
+        size_t block_class = alloc_checker::kSizeClasses;
+        for (size_t i = 0; i < alloc_checker::kSizeClasses; ++i) {
+            if (after.size_classes[i].allocations != before.size_classes[i].allocations) {
+                block_class = i;
+            }
+            live += after.size_classes[i].live_bytes - before.size_classes[i].live_bytes;
+        }
+        REQUIRE(block_class < alloc_checker::kSizeClasses);
+        REQUIRE(after.size_classes[block_class].max_size >= live);
+        REQUIRE(live >= 200);
+
+        sp.Reset();
+        auto freed = alloc_checker::Snapshot();
+        REQUIRE(freed.deallocations == after.deallocations + 1);
+        size_t still_live = 0;
+        for (size_t i = 0; i < alloc_checker::kSizeClasses; ++i) {
+            still_live += freed.size_classes[i].live_bytes - before.size_classes[i].live_bytes;
+        }
+        REQUIRE(still_live == 0);
+    }
+
+    SECTION("Backtrace sampling") {
+        alloc_checker::ClearSamples();
+        alloc_checker::SetBacktraceSampling(1);
+        for (int i = 0; i < 4; ++i) {
+            MakeShared<int>(i);
+        }
+        alloc_checker::SetBacktraceSampling(0);
+
+        auto samples = alloc_checker::Samples();
+        REQUIRE(samples.size() >= 4);
+        for (const auto& sample : samples) {
+            REQUIRE(sample.depth > 0);
+        }
+        alloc_checker::ClearSamples();
+    }
+}
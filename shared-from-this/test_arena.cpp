@@ -0,0 +1,130 @@
+#include "arena.h"
+#include "shared.h"
+#include "weak.h"
+#include "allocations_checker.h"
+
+#include <catch.hpp>
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+std::vector<int> destroyed;
+
+struct Tracked {
+    explicit Tracked(int id) : id(id) {
+    }
+
+    ~Tracked() {
+        destroyed.push_back(id);
+    }
+
+    int id;
+};
+
+struct alignas(64) Wide {
+    char data[64] = {};
+};
+
+struct Throwing {
+    Throwing() {
+        throw std::runtime_error("no");
+    }
+};
+
+struct User {
+    std::string name;
+};
+
+struct Request {
+    int id = 0;
+    User* user = nullptr;
+};
+
+}  // namespace
+
+TEST_CASE("SharedPtrArena") {
+    destroyed.clear();
+
+    SECTION("One count for all the objects") {
+        SharedPtrArena<> arena;
+        auto first = arena.MakeShared<Tracked>(1);
+        auto second = arena.MakeShared<Tracked>(2);
+        REQUIRE(first->id == 1);
+        REQUIRE(second->id == 2);
+        REQUIRE(arena.UseCount() == 3);
+        REQUIRE(first.UseCount() == 3);
+
+        auto copy = first;
+        REQUIRE(second.UseCount() == 4);
+    }
+
+    SECTION("Destroyed together with the last pointer, in reverse order") {
+        SharedPtr<Tracked> survivor;
+        WeakPtr<Tracked> weak;
+        {
+            SharedPtrArena<> arena;
+            survivor = arena.MakeShared<Tracked>(1);
+            weak = arena.MakeShared<Tracked>(2);
+            arena.New<Tracked>(3);
+        }
+        REQUIRE(destroyed.empty());
+        REQUIRE(!weak.Expired());  // the object is still there, only its pointer has gone
+
+        survivor.Reset();
+        REQUIRE(destroyed == std::vector<int>{3, 2, 1});
+        REQUIRE(weak.Expired());
+    }
+
+    SECTION("A graph with plain edges") {
+        SharedPtr<Request> request;
+        {
+            SharedPtrArena<> arena;
+            request = arena.MakeShared<Request>();
+            request->user = arena.New<User>("a name that doesn't fit into the small buffer");
+        }
+        REQUIRE(request->user->name.size() > 40);
+    }
+
+    SECTION("Alignment and big objects") {
+        SharedPtrArena<> arena(128);
+        for (int i = 0; i < 10; ++i) {
+            arena.New<char>('x');
+            auto wide = arena.New<Wide>();
+            REQUIRE(reinterpret_cast<uintptr_t>(wide) % 64 == 0);
+        }
+        auto big = arena.New<std::vector<int>>(1000, 7);
+        REQUIRE(big->at(999) == 7);
+        REQUIRE(arena.Allocated() >= 10 * (1 + sizeof(Wide)));
+    }
+
+    SECTION("Few allocations") {
+        {
+            auto before = alloc_checker::AllocCount();
+            SharedPtrArena<> arena;
+            for (int i = 0; i < 100; ++i) {
+                arena.New<Tracked>(i);
+            }
+            REQUIRE(alloc_checker::AllocCount() - before <= 2);  // the block and one chunk
+        }
+        REQUIRE(destroyed.size() == 100);
+    }
+
+    SECTION("A throwing constructor leaves the arena usable") {
+        SharedPtrArena<> arena;
+        arena.New<Tracked>(1);
+        REQUIRE_THROWS_AS(arena.New<Throwing>(), std::runtime_error);
+        arena.New<Tracked>(2);
+    }
+
+    SECTION("Other policies") {
+        SharedPtrArena<SingleThreadedRefCount> arena;
+        auto ptr = arena.MakeShared<Tracked>(1);
+        REQUIRE(ptr.UseCount() == 2);
+    }
+}
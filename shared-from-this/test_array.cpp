@@ -0,0 +1,123 @@
+#include "shared.h"
+#include "weak.h"
+
+#include <catch.hpp>
+
+#include "allocations_checker.h"
+
+#include <cstdint>
+#include <stdexcept>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+struct Element {
+    Element() : value(next++) {
+        if (value == throw_at) {
+            throw std::runtime_error("element");
+        }
+        ++alive;
+    }
+
+    ~Element() {
+        --alive;
+    }
+
+    int value;
+
+    inline static int alive = 0;
+    inline static int next = 0;
+    inline static int throw_at = -1;
+};
+
+bool IsCacheAligned(const void* ptr) {
+    return reinterpret_cast<std::uintptr_t>(ptr) % kCacheLineSize == 0;
+}
+
+}  // namespace
+
+TEST_CASE("MakeShared for arrays") {
+    Element::next = 0;
+    Element::throw_at = -1;
+
+    SECTION("Unbounded") {
+        SharedPtr<int[]> sp;
+        EXPECT_ONE_ALLOCATION(sp = MakeShared<int[]>(100));
+        REQUIRE(sp.UseCount() == 1);
+        REQUIRE(IsCacheAligned(sp.Get()));
+        for (int i = 0; i < 100; ++i) {
+            REQUIRE(sp[i] == 0);
+            sp[i] = i;
+        }
+        auto copy = sp;
+        REQUIRE(copy[99] == 99);
+        REQUIRE(sp.UseCount() == 2);
+    }
+
+    SECTION("Bounded") {
+        auto sp = MakeShared<double[4]>();
+        static_assert(std::is_same_v<decltype(sp.Get()), double*>);
+        REQUIRE(sp[3] == 0.0);
+    }
+
+    SECTION("Elements are destroyed") {
+        {
+            auto sp = MakeShared<Element[]>(10);
+            REQUIRE(Element::alive == 10);
+            REQUIRE(sp[9].value == 9);
+        }
+        REQUIRE(Element::alive == 0);
+    }
+
+    SECTION("Elements outlived by a weak pointer") {
+        WeakPtr<Element[]> wp;
+        {
+            auto sp = MakeShared<Element[]>(3);
+            wp = sp;
+            REQUIRE(wp.Lock()[2].value == 2);
+        }
+        REQUIRE(Element::alive == 0);
+        REQUIRE(wp.Expired());
+    }
+
+    SECTION("Throwing element") {
+        Element::throw_at = 5;
+        REQUIRE_THROWS_AS(MakeShared<Element[]>(10), std::runtime_error);
+        REQUIRE(Element::alive == 0);
+    }
+
+    SECTION("Empty") {
+        auto sp = MakeShared<int[]>(0);
+        REQUIRE(sp);
+        REQUIRE(sp.UseCount() == 1);
+    }
+
+    SECTION("Too big") {
+        REQUIRE_THROWS_AS(MakeShared<int[]>(SIZE_MAX / 2), std::bad_array_new_length);
+    }
+
+    SECTION("Over-aligned elements") {
+        struct alignas(128) Wide {
+            char data[128];
+        };
+        auto sp = MakeShared<Wide[]>(2);
+        REQUIRE(reinterpret_cast<std::uintptr_t>(sp.Get()) % 128 == 0);
+    }
+
+    SECTION("For overwrite") {
+        SharedPtr<char[]> sp;
+        EXPECT_ONE_ALLOCATION(sp = MakeSharedForOverwrite<char[]>(1 << 16));
+        REQUIRE(IsCacheAligned(sp.Get()));
+
+        auto elements = MakeSharedForOverwrite<Element[3]>();
+        REQUIRE(Element::alive == 3);
+    }
+
+    SECTION("From new[]") {
+        SharedPtr<Element[]> sp(new Element[4]);
+        REQUIRE(Element::alive == 4);
+        sp.Reset();
+        REQUIRE(Element::alive == 0);
+    }
+}
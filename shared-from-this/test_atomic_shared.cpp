@@ -0,0 +1,134 @@
+#include "atomic_shared.h"
+
+#include <catch.hpp>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+struct Version {
+    explicit Version(int id) : id(id) {
+        alive.fetch_add(1);
+    }
+
+    ~Version() {
+        alive.fetch_sub(1);
+    }
+
+    int id;
+
+    inline static std::atomic<int> alive = 0;
+};
+
+}  // namespace
+
+TEST_CASE("AtomicSharedPtr") {
+    static_assert(AtomicSharedPtr<int>::kIsAlwaysLockFree);
+
+    SECTION("Empty") {
+        AtomicSharedPtr<int> ptr;
+        REQUIRE(ptr.IsLockFree());
+        REQUIRE(ptr.Load().Get() == nullptr);
+        REQUIRE(ptr.Exchange(nullptr).Get() == nullptr);
+    }
+
+    SECTION("Load and store") {
+        auto first = MakeShared<int>(1);
+        AtomicSharedPtr<int> ptr(first);
+        REQUIRE(first.UseCount() == 2);
+
+        auto loaded = ptr.Load();
+        REQUIRE(loaded == first);
+        REQUIRE(first.UseCount() == 3);
+
+        ptr.Store(MakeShared<int>(2));
+        REQUIRE(first.UseCount() == 2);
+        REQUIRE(*ptr.Load() == 2);
+
+        ptr.Store(nullptr);
+        REQUIRE(ptr.Load().Get() == nullptr);
+    }
+
+    SECTION("Exchange") {
+        AtomicSharedPtr<int> ptr(MakeShared<int>(1));
+        auto old = ptr.Exchange(MakeShared<int>(2));
+        REQUIRE(*old == 1);
+        REQUIRE(old.UseCount() == 1);
+        REQUIRE(*ptr.Load() == 2);
+    }
+
+    SECTION("CompareExchange") {
+        auto first = MakeShared<int>(1);
+        AtomicSharedPtr<int> ptr(first);
+
+        SharedPtr<int> expected = MakeShared<int>(1);
+        REQUIRE_FALSE(ptr.CompareExchange(expected, MakeShared<int>(2)));
+        REQUIRE(expected == first);
+
+        auto second = MakeShared<int>(2);
+        REQUIRE(ptr.CompareExchange(expected, second));
+        REQUIRE(expected == first);
+        REQUIRE(ptr.Load() == second);
+        REQUIRE(first.UseCount() == 2);
+
+        SharedPtr<int> empty;
+        REQUIRE_FALSE(ptr.CompareExchange(empty, nullptr));
+        REQUIRE(empty == second);
+        REQUIRE(ptr.CompareExchange(empty, nullptr));
+        REQUIRE(ptr.Load().Get() == nullptr);
+        REQUIRE(second.UseCount() == 2);
+    }
+
+    SECTION("Readers and writers") {
+        constexpr int kReaders = 4;
+        constexpr int kWriters = 2;
+        constexpr int kIterations = 20000;
+
+        {
+            AtomicSharedPtr<Version> ptr(MakeShared<Version>(0));
+            std::atomic<bool> done = false;
+            std::atomic<int> failures = 0;
+
+            std::vector<std::thread> threads;
+            for (int i = 0; i < kReaders; ++i) {
+                threads.emplace_back([&] {
+                    while (!done.load()) {
+                        auto version = ptr.Load();
+                        if (version.Get() == nullptr || version->id < 0) {
+                            failures.fetch_add(1);
+                        }
+                    }
+                });
+            }
+            std::vector<std::thread> writers;
+            for (int i = 0; i < kWriters; ++i) {
+                writers.emplace_back([&, i] {
+                    for (int j = 1; j <= kIterations; ++j) {
+                        if (j % 2 == 0) {
+                            ptr.Store(MakeShared<Version>(j));
+                            continue;
+                        }
+                        auto expected = ptr.Load();
+                        while (!ptr.CompareExchange(expected, MakeShared<Version>(j + i))) {
+                        }
+                    }
+                });
+            }
+            for (auto& writer : writers) {
+                writer.join();
+            }
+            done.store(true);
+            for (auto& thread : threads) {
+                thread.join();
+            }
+
+            REQUIRE(failures.load() == 0);
+            REQUIRE(Version::alive.load() == 1);
+        }
+        REQUIRE(Version::alive.load() == 0);
+    }
+}
@@ -0,0 +1,109 @@
+#include "borrowed.h"
+#include "shared.h"
+#include "weak.h"
+
+#include <catch.hpp>
+
+#include <type_traits>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+struct Base {
+    virtual ~Base() = default;
+
+    int value = 1;
+};
+
+struct Derived : Base {
+    Derived() {
+        value = 2;
+    }
+};
+
+struct Counted : SimpleRefCounted<Counted> {
+    int value = 3;
+};
+
+int Read(BorrowedPtr<const Base> ptr) {
+    return ptr ? ptr->value : 0;
+}
+
+}  // namespace
+
+static_assert(std::is_trivially_copyable_v<BorrowedPtr<int, AtomicRefCount, false>>);
+static_assert(!std::is_constructible_v<BorrowedPtr<int>, SharedPtr<int>&&>);
+static_assert(!std::is_constructible_v<BorrowedPtr<int>, UniquePtr<int>&&>);
+static_assert(!std::is_constructible_v<BorrowedPtr<int>, const SharedPtr<int, SingleThreadedRefCount>&>);
+
+TEST_CASE("BorrowedPtr") {
+    SECTION("Borrowing doesn't touch the counter") {
+        auto owner = MakeShared<Derived>();
+        BorrowedPtr<Base> borrowed = owner;
+        auto copy = borrowed;
+        REQUIRE(owner.UseCount() == 1);
+        REQUIRE(copy.Get() == owner.Get());
+        REQUIRE(Read(owner) == 2);
+        REQUIRE(Read(copy) == 2);
+        REQUIRE(owner.UseCount() == 1);
+    }
+
+    SECTION("ToShared shares the owner's block") {
+        auto owner = MakeShared<Derived>();
+        WeakPtr<Derived> weak(owner);
+        BorrowedPtr<Base> borrowed = owner;
+        auto shared = borrowed.ToShared();
+        REQUIRE(owner.UseCount() == 2);
+        REQUIRE(shared.Get() == owner.Get());
+
+        owner.Reset();
+        REQUIRE(!weak.Expired());
+        REQUIRE(shared->value == 2);
+        shared.Reset();
+        REQUIRE(weak.Expired());
+    }
+
+    SECTION("Other owners") {
+        UniquePtr<Derived> unique(new Derived);
+        REQUIRE(Read(unique) == 2);
+        BorrowedPtr borrowed_unique(unique);
+        REQUIRE(!borrowed_unique.ToShared());
+
+        IntrusivePtr<Counted> intrusive(new Counted);
+        BorrowedPtr borrowed_intrusive(intrusive);
+        REQUIRE(borrowed_intrusive->value == 3);
+        REQUIRE(intrusive.UseCount() == 1);
+        auto upgraded = borrowed_intrusive.ToIntrusive();
+        REQUIRE(intrusive.UseCount() == 2);
+        REQUIRE(upgraded.Get() == intrusive.Get());
+    }
+
+    SECTION("Empty") {
+        SharedPtr<Base> owner;
+        REQUIRE(Read(owner) == 0);
+        REQUIRE(Read(nullptr) == 0);
+        REQUIRE(!BorrowedPtr<Base>(owner).ToShared());
+    }
+
+    SECTION("Checked views keep only the block") {
+        auto owner = MakeShared<Derived>();
+        WeakPtr<Derived> weak(owner);
+        {
+            BorrowedPtr<Derived, AtomicRefCount, true> borrowed = owner;
+            auto assigned = borrowed;
+            assigned = borrowed;
+            REQUIRE(assigned->value == 2);
+            REQUIRE(owner.UseCount() == 1);
+        }
+        owner.Reset();
+        REQUIRE(weak.Expired());
+    }
+
+    SECTION("Other policies") {
+        auto owner = MakeShared<int, SingleThreadedRefCount>(4);
+        BorrowedPtr borrowed(owner);
+        REQUIRE(*borrowed == 4);
+        REQUIRE(borrowed.ToShared().UseCount() == 2);
+    }
+}
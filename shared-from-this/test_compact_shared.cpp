@@ -0,0 +1,124 @@
+#include "compact_shared.h"
+#include "shared.h"
+#include "weak.h"
+
+#include <catch.hpp>
+
+#include <utility>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+struct Node final {
+    explicit Node(int id) : id(id) {
+        alive += 1;
+    }
+
+    ~Node() {
+        alive -= 1;
+    }
+
+    int id;
+
+    inline static int alive = 0;
+};
+
+struct Self : EnableSharedFromThis<Self> {};
+
+}  // namespace
+
+static_assert(sizeof(CompactSharedPtr<Node>) == sizeof(void*));
+
+TEST_CASE("CompactSharedPtr") {
+    SECTION("Copies share the object") {
+        auto first = MakeCompactShared<Node>(7);
+        auto second = first;
+        REQUIRE(first.UseCount() == 2);
+        REQUIRE(second->id == 7);
+        REQUIRE(&*first == second.Get());
+        REQUIRE(first == second);
+
+        first.Reset();
+        REQUIRE(!first);
+        REQUIRE(first.Get() == nullptr);
+        REQUIRE(Node::alive == 1);
+        second = nullptr;
+        REQUIRE(Node::alive == 0);
+    }
+
+    SECTION("Moves and assignments") {
+        auto first = MakeCompactShared<Node>(1);
+        auto second = MakeCompactShared<Node>(2);
+        auto moved = std::move(first);
+        REQUIRE(!first);
+        REQUIRE(moved.UseCount() == 1);
+
+        second = moved;
+        REQUIRE(Node::alive == 1);
+        REQUIRE(second->id == 1);
+        second = std::move(second);
+        REQUIRE(second->id == 1);
+        moved = std::move(second);
+        REQUIRE(moved.UseCount() == 1);
+    }
+
+    SECTION("WeakPtr") {
+        auto ptr = MakeCompactShared<Node>(3);
+        WeakPtr<Node> weak(ptr);
+        REQUIRE(weak.UseCount() == 1);
+
+        auto locked = weak.Lock();
+        REQUIRE(locked.Get() == ptr.Get());
+        REQUIRE(ptr.UseCount() == 2);
+
+        locked.Reset();
+        ptr.Reset();
+        REQUIRE(weak.Expired());
+        REQUIRE(Node::alive == 0);
+    }
+
+    SECTION("Converts to SharedPtr") {
+        auto ptr = MakeCompactShared<Node>(4);
+        SharedPtr<Node> copy = ptr;
+        REQUIRE(copy.Get() == ptr.Get());
+        REQUIRE(ptr.UseCount() == 2);
+
+        SharedPtr<Node> moved = std::move(ptr);
+        REQUIRE(!ptr);
+        REQUIRE(moved.UseCount() == 2);
+        REQUIRE(moved->id == 4);
+
+        SharedPtr<Node> empty = CompactSharedPtr<Node>();
+        REQUIRE(!empty);
+    }
+
+    SECTION("Vector of handles") {
+        std::vector<CompactSharedPtr<Node>> nodes;
+        for (int i = 0; i < 100; ++i) {
+            nodes.push_back(MakeCompactShared<Node>(i));
+        }
+        auto copy = nodes;
+        REQUIRE(nodes[42].UseCount() == 2);
+        nodes.clear();
+        REQUIRE(Node::alive == 100);
+        copy.clear();
+        REQUIRE(Node::alive == 0);
+    }
+
+    SECTION("SharedFromThis") {
+        auto ptr = MakeCompactShared<Self>();
+        auto shared = ptr->SharedFromThis();
+        REQUIRE(shared.Get() == ptr.Get());
+        REQUIRE(ptr.UseCount() == 2);
+    }
+
+    SECTION("Other policies") {
+        auto ptr = MakeCompactShared<Node, SingleThreadedRefCount>(5);
+        auto copy = ptr;
+        WeakPtr<Node, SingleThreadedRefCount> weak(copy);
+        REQUIRE(weak.Lock()->id == 5);
+        REQUIRE(copy.UseCount() == 2);
+    }
+}
@@ -0,0 +1,159 @@
+#include "deferred_destroy.h"
+#include "shared.h"
+#include "weak.h"
+
+#include <catch.hpp>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+struct Payload {
+    Payload() {
+        alive.fetch_add(1);
+    }
+
+    ~Payload() {
+        while (!proceed.load()) {
+            std::this_thread::yield();
+        }
+        destroyed_on = std::this_thread::get_id();
+        alive.fetch_sub(1);
+    }
+
+    inline static std::atomic<int> alive = 0;
+    inline static std::atomic<bool> proceed = true;
+    inline static std::thread::id destroyed_on;
+};
+
+struct Task final : Reclaimer::Task {
+    Task() noexcept : Reclaimer::Task(&Run) {
+    }
+
+    static void Run(Reclaimer::Task* task) noexcept {
+        ++done;
+        delete static_cast<Task*>(task);
+    }
+
+    inline static int done = 0;
+};
+
+}  // namespace
+
+TEST_CASE("Reclaimer") {
+    SECTION("Tasks run on the reclaimer thread") {
+        Task::done = 0;
+        Reclaimer reclaimer;
+        for (int i = 0; i < 10; ++i) {
+            reclaimer.Enqueue(new Task);
+        }
+        reclaimer.Flush();
+        REQUIRE(Task::done == 10);
+
+        auto stats = reclaimer.GetStats();
+        REQUIRE(stats.queued == 0);
+        REQUIRE(stats.reclaimed == 10);
+        REQUIRE(stats.max_latency.count() > 0);
+        REQUIRE(stats.total_latency >= stats.max_latency);
+    }
+
+    SECTION("Destructor runs the rest") {
+        Task::done = 0;
+        {
+            Reclaimer reclaimer;
+            reclaimer.Enqueue(new Task);
+        }
+        REQUIRE(Task::done == 1);
+    }
+
+    SECTION("Many producers") {
+        Task::done = 0;
+        Reclaimer reclaimer;
+        std::vector<std::thread> producers;
+        for (int i = 0; i < 4; ++i) {
+            producers.emplace_back([&] {
+                for (int j = 0; j < 1000; ++j) {
+                    reclaimer.Enqueue(new Task);
+                }
+            });
+        }
+        for (auto& producer : producers) {
+            producer.join();
+        }
+        reclaimer.Flush();
+        REQUIRE(Task::done == 4000);
+        REQUIRE(reclaimer.GetStats().reclaimed == 4000);
+    }
+}
+
+TEST_CASE("Deferred destruction") {
+    auto& reclaimer = DefaultReclaimer();
+
+    SECTION("MakeSharedDeferred") {
+        auto sp = MakeSharedDeferred<Payload>();
+        auto copy = sp;
+        sp.Reset();
+        copy.Reset();
+        reclaimer.Flush();
+        REQUIRE(Payload::alive.load() == 0);
+        REQUIRE(Payload::destroyed_on != std::this_thread::get_id());
+    }
+
+    SECTION("Queued objects are counted") {
+        auto before = reclaimer.GetStats().reclaimed;
+        Payload::proceed.store(false);
+        MakeSharedDeferred<Payload>().Reset();
+        MakeSharedDeferred<Payload>().Reset();
+        REQUIRE(reclaimer.GetStats().queued == 2);
+        REQUIRE(Payload::alive.load() >= 1);
+
+        Payload::proceed.store(true);
+        reclaimer.Flush();
+        REQUIRE(Payload::alive.load() == 0);
+        REQUIRE(reclaimer.GetStats().reclaimed == before + 2);
+        REQUIRE(reclaimer.GetStats().queued == 0);
+    }
+
+    SECTION("Weak pointers outlive the object") {
+        WeakPtr<Payload> wp;
+        {
+            auto sp = MakeSharedDeferred<Payload>();
+            wp = sp;
+        }
+        REQUIRE(wp.Expired());
+        reclaimer.Flush();
+        REQUIRE(Payload::alive.load() == 0);
+        wp.Reset();
+    }
+
+    SECTION("Weak pointers go first") {
+        auto sp = MakeSharedDeferred<Payload>();
+        { WeakPtr<Payload> wp(sp); }
+        sp.Reset();
+        reclaimer.Flush();
+        REQUIRE(Payload::alive.load() == 0);
+    }
+
+    SECTION("DeferredDelete") {
+        int deleted = 0;
+        auto deleter = [&deleted](Payload* ptr) {
+            delete ptr;
+            ++deleted;
+        };
+        Reclaimer local;
+        SharedPtr<Payload> sp(new Payload, DeferredDelete<Payload, decltype(deleter)>(deleter, local));
+        sp.Reset();
+        local.Flush();
+        REQUIRE(deleted == 1);
+        REQUIRE(Payload::alive.load() == 0);
+        REQUIRE(Payload::destroyed_on != std::this_thread::get_id());
+    }
+
+    SECTION("Unused deleter") {
+        DeferredDelete<Payload> deleter;
+    }
+}
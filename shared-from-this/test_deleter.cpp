@@ -0,0 +1,117 @@
+#include "shared.h"
+#include "weak.h"
+
+#include <unique/deleters.h>
+
+#include <catch.hpp>
+
+#include <new>
+
+#include "allocations_checker.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+int deleted_count = 0;
+
+struct EmptyDeleter {
+    void operator()(int* ptr) const noexcept {
+        ++deleted_count;
+        delete ptr;
+    }
+};
+
+void FreeDeleter(int* ptr) {
+    ++deleted_count;
+    delete ptr;
+}
+
+}  // namespace
+
+TEST_CASE("Custom deleter") {
+    deleted_count = 0;
+
+    SECTION("Stateless deleter is free") {
+        using Default = ControlBlockPtr<int, AtomicRefCount>;
+        using Custom = ControlBlockPtr<int, AtomicRefCount, EmptyDeleter>;
+        static_assert(sizeof(Custom) == sizeof(Default));
+
+        {
+            SharedPtr<int> sp(new int(42), EmptyDeleter());
+            auto sp2 = sp;
+            REQUIRE(*sp2 == 42);
+        }
+        REQUIRE(deleted_count == 1);
+    }
+
+    SECTION("Function pointer") {
+        {
+            SharedPtr<int> sp(new int(1), &FreeDeleter);
+            REQUIRE(sp.UseCount() == 1);
+        }
+        REQUIRE(deleted_count == 1);
+    }
+
+    SECTION("Stateful deleter") {
+        int calls = 0;
+        WeakPtr<int> wp;
+        {
+            SharedPtr<int> sp(new int(1), [&calls](int* ptr) {
+                ++calls;
+                delete ptr;
+            });
+            wp = sp;
+        }
+        REQUIRE(calls == 1);
+        REQUIRE(wp.Expired());
+    }
+
+    SECTION("Reset") {
+        SharedPtr<int> sp;
+        sp.Reset(new int(1), EmptyDeleter());
+        REQUIRE(*sp == 1);
+        sp.Reset(new int(2), EmptyDeleter());
+        REQUIRE(deleted_count == 1);
+        REQUIRE(*sp == 2);
+        sp.Reset();
+        REQUIRE(deleted_count == 2);
+    }
+}
+
+TEST_CASE("SharedPtr from UniquePtr") {
+    SECTION("Default deleter") {
+        UniquePtr<int> up(new int(42));
+        SharedPtr<int> sp;
+        EXPECT_ONE_ALLOCATION(sp = SharedPtr<int>(std::move(up)));
+        REQUIRE(up.Get() == nullptr);
+        REQUIRE(*sp == 42);
+        REQUIRE(sp.UseCount() == 1);
+    }
+
+    SECTION("Move-only deleter") {
+        UniquePtr<int, Deleter<int>> up(new int(42), Deleter<int>(7));
+        SharedPtr<int> sp(std::move(up));
+        REQUIRE(up.Get() == nullptr);
+        REQUIRE(up.GetDeleter().GetTag() == 0);
+        REQUIRE(*sp == 42);
+    }
+
+    SECTION("Empty") {
+        UniquePtr<int> up;
+        EXPECT_ZERO_ALLOCATIONS(SharedPtr<int> sp(std::move(up)));
+    }
+
+    SECTION("Failed block allocation") {
+        // As with `std::shared_ptr`, the `UniquePtr` keeps the object and the deleter
+        UniquePtr<int, Deleter<int>> up(new int(42), Deleter<int>(7));
+        if (!alloc_checker::FailNextAllocation()) {
+            return;  // sanitizer builds can't make `operator new` fail
+        }
+        REQUIRE_THROWS_AS(SharedPtr<int>(std::move(up)), std::bad_alloc);
+        REQUIRE(up.Get() != nullptr);
+        REQUIRE(*up == 42);
+        REQUIRE(up.GetDeleter().GetTag() == 7);
+        REQUIRE(!up.GetDeleter().WasCalled());
+    }
+}
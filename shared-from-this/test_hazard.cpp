@@ -0,0 +1,162 @@
+#include "hazard.h"
+#include "shared.h"
+
+#include <intrusive/intrusive.h>
+
+#include <catch.hpp>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+int reclaimed = 0;
+
+struct Item final : HazardDomain::Retired {
+    Item() noexcept : Retired(&Reclaim) {
+    }
+
+    static void Reclaim(HazardDomain::Retired* self) noexcept {
+        ++reclaimed;
+        delete static_cast<Item*>(self);
+    }
+};
+
+struct Config : ThreadSafeRefCounted<Config> {
+    explicit Config(int version) : version(version) {
+    }
+
+    int version;
+};
+
+}  // namespace
+
+TEST_CASE("HazardDomain") {
+    reclaimed = 0;
+    HazardDomain domain;
+
+    SECTION("Unprotected objects are reclaimed") {
+        domain.Retire(new Item);
+        domain.Retire(new Item);
+        REQUIRE(domain.RetiredCount() == 2);
+        domain.Reclaim();
+        REQUIRE(reclaimed == 2);
+        REQUIRE(domain.RetiredCount() == 0);
+    }
+
+    SECTION("Protected object survives") {
+        std::atomic<Item*> source = new Item;
+        HazardPtr hazard(domain);
+        auto item = hazard.Protect(source);
+        REQUIRE(item == source.load());
+
+        source.store(nullptr);
+        domain.Retire(item);
+        domain.Reclaim();
+        REQUIRE(reclaimed == 0);
+
+        hazard.Reset();
+        domain.Reclaim();
+        REQUIRE(reclaimed == 1);
+    }
+
+    SECTION("Slots are reused") {
+        { HazardPtr first(domain); }
+        { HazardPtr second(domain); }
+        std::atomic<Item*> source = new Item;
+        HazardPtr hazard(domain);
+        domain.Retire(hazard.Protect(source));
+        domain.Reclaim();
+        REQUIRE(reclaimed == 0);
+        hazard = HazardPtr(domain);
+        domain.Reclaim();
+        REQUIRE(reclaimed == 1);
+    }
+
+    SECTION("Domain reclaims the rest") {
+        {
+            HazardDomain local;
+            local.Retire(new Item);
+        }
+        REQUIRE(reclaimed == 1);
+    }
+}
+
+TEST_CASE("ReadMostly") {
+    HazardDomain domain;
+
+    SECTION("SharedPtr") {
+        auto first = MakeShared<int>(1);
+        ReadMostly<SharedPtr<int>> table(first, domain);
+        REQUIRE(first.UseCount() == 2);
+
+        HazardPtr hazard(domain);
+        auto value = table.Protect(hazard);
+        REQUIRE(*value == 1);
+        REQUIRE(first.UseCount() == 2);
+
+        table.Store(MakeShared<int>(2));
+        first.Reset();
+        domain.Reclaim();
+        REQUIRE(*value == 1);  // still protected
+
+        hazard.Reset();
+        domain.Reclaim();
+        auto loaded = table.Load();
+        REQUIRE(*loaded == 2);
+        REQUIRE(loaded.UseCount() == 2);
+    }
+
+    SECTION("IntrusivePtr") {
+        ReadMostly<IntrusivePtr<Config>> config(MakeIntrusive<Config>(1), domain);
+        HazardPtr hazard(domain);
+        REQUIRE(config.Protect(hazard)->version == 1);
+        REQUIRE(config.Protect(hazard)->RefCount() == 1);
+
+        config.Store(MakeIntrusive<Config>(2));
+        REQUIRE(config.Load()->version == 2);
+    }
+
+    SECTION("Empty") {
+        ReadMostly<SharedPtr<int>> table(nullptr, domain);
+        HazardPtr hazard(domain);
+        REQUIRE(table.Protect(hazard) == nullptr);
+    }
+
+    SECTION("Readers and writers") {
+        constexpr int kReaders = 4;
+        constexpr int kVersions = 5000;
+
+        ReadMostly<IntrusivePtr<Config>> config(MakeIntrusive<Config>(0), domain);
+        std::atomic<bool> done = false;
+        std::atomic<int> failures = 0;
+
+        std::vector<std::thread> readers;
+        for (int i = 0; i < kReaders; ++i) {
+            readers.emplace_back([&] {
+                HazardPtr hazard(domain);
+                int last = 0;
+                while (!done.load()) {
+                    auto version = config.Protect(hazard)->version;
+                    if (version < last) {
+                        failures.fetch_add(1);
+                    }
+                    last = version;
+                }
+            });
+        }
+        for (int i = 1; i <= kVersions; ++i) {
+            config.Store(MakeIntrusive<Config>(i));
+        }
+        done.store(true);
+        for (auto& reader : readers) {
+            reader.join();
+        }
+
+        REQUIRE(failures.load() == 0);
+        REQUIRE(domain.RetiredCount() < kVersions);
+    }
+}
@@ -0,0 +1,124 @@
+#include "biased_ref_count.h"
+#include "shared.h"
+#include "weak.h"
+
+#include <common/instrumentation.h>
+
+#include <catch.hpp>
+
+#include <thread>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+using Kind = PointerStats::Kind;
+
+template <class T>
+using Shared = SharedPtr<T, InstrumentedRefCount<>>;
+
+template <class T>
+using Weak = WeakPtr<T, InstrumentedRefCount<>>;
+
+struct Node : RefCounted<Node, InstrumentedCounter<>> {
+    int value = 0;
+};
+
+size_t Lifetimes(const PointerStats::Counters& counters) {
+    size_t total = 0;
+    for (auto count : counters.lifetimes) {
+        total += count;
+    }
+    return total;
+}
+
+}  // namespace
+
+TEST_CASE("Instrumentation") {
+    static_assert(sizeof(Shared<int>) == sizeof(SharedPtr<int>));
+    static_assert(sizeof(InstrumentedRefCount<>) == sizeof(AtomicRefCount) + sizeof(int64_t));
+
+    SECTION("SharedPtr and WeakPtr") {
+        auto before = PointerStats::Collect()[Kind::kShared];
+        {
+            auto sp = MakeShared<int, InstrumentedRefCount<>>(1);
+            Shared<int> raw(new int(2));
+            Shared<int> copy = sp;
+            Shared<int> another = copy;
+            Weak<int> wp(sp);
+            REQUIRE(wp.Lock());
+            raw.Reset();
+            Weak<int> expired(raw = Shared<int>(new int(3)));
+            raw.Reset();
+            REQUIRE(!expired.Lock());
+        }
+        auto after = PointerStats::Collect()[Kind::kShared];
+        REQUIRE(after.inline_blocks - before.inline_blocks == 1);
+        REQUIRE(after.separate_blocks - before.separate_blocks == 2);
+        REQUIRE(after.copies - before.copies == 2);
+        REQUIRE(after.lock_attempts - before.lock_attempts == 2);
+        REQUIRE(after.lock_failures - before.lock_failures == 1);
+        REQUIRE(after.destroyed - before.destroyed == 3);
+        REQUIRE(Lifetimes(after) - Lifetimes(before) == 3);
+        REQUIRE(after.peak_use_count >= 4);  // `wp.Lock()` made the fourth reference
+    }
+
+    SECTION("Wrapping a policy which defers releases") {
+        using Policy = InstrumentedRefCount<BiasedRefCount>;
+        auto before = PointerStats::Collect()[Kind::kShared];
+        {
+            auto owned = MakeShared<int, Policy>(1);
+            REQUIRE(SharedPtr<int, Policy>(owned).UseCount() == 2);
+        }
+
+        // The last reference dies on another thread, the owner finishes the release
+        auto escaped = MakeShared<int, Policy>(2);
+        WeakPtr<int, Policy> weak(escaped);
+        std::thread([moved = std::move(escaped)]() mutable { moved.Reset(); }).join();
+        REQUIRE(weak.Expired());
+        auto pending = PointerStats::Collect()[Kind::kShared];
+        REQUIRE(pending.destroyed - before.destroyed == 1);
+        BiasedRefCount::ProcessQueue();
+
+        auto after = PointerStats::Collect()[Kind::kShared];
+        REQUIRE(after.inline_blocks - before.inline_blocks == 2);
+        REQUIRE(after.destroyed - before.destroyed == 2);
+    }
+
+    SECTION("IntrusivePtr") {
+        auto before = PointerStats::Collect()[Kind::kIntrusive];
+        {
+            auto first = MakeIntrusive<Node>();
+            auto second = first;
+            IntrusivePtr<Node> third(first.Get());
+        }
+        auto after = PointerStats::Collect()[Kind::kIntrusive];
+        REQUIRE(after.copies - before.copies == 2);
+        REQUIRE(after.destroyed - before.destroyed == 1);
+        REQUIRE(after.peak_use_count >= 3);
+    }
+
+    SECTION("UniquePtr") {
+        auto before = PointerStats::Collect()[Kind::kUnique];
+        {
+            UniquePtr<int, InstrumentedDelete<int>> ptr(new int(1));
+            ptr.Reset(new int(2));
+            UniquePtr<int, InstrumentedDelete<int>> empty;
+        }
+        auto after = PointerStats::Collect()[Kind::kUnique];
+        REQUIRE(after.destroyed - before.destroyed == 2);
+        REQUIRE(Lifetimes(after) - Lifetimes(before) == 2);
+    }
+
+    SECTION("Counts of finished threads are kept") {
+        auto before = PointerStats::Collect()[Kind::kShared];
+        auto sp = MakeShared<int, InstrumentedRefCount<>>(1);
+        std::thread([sp] {
+            for (int i = 0; i < 100; ++i) {
+                Shared<int> copy = sp;
+            }
+        }).join();
+        auto after = PointerStats::Collect()[Kind::kShared];
+        REQUIRE(after.copies - before.copies == 101);  // the thread's own copy too
+    }
+}
@@ -0,0 +1,311 @@
+#include "shared.h"
+#include "weak.h"
+#include "biased_ref_count.h"
+#include "packed_ref_count.h"
+
+#include <catch.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+struct Counted {
+    Counted() {
+        alive.fetch_add(1);
+    }
+
+    ~Counted() {
+        alive.fetch_sub(1);
+    }
+
+    inline static std::atomic<int> alive = 0;
+};
+
+}  // namespace
+
+TEST_CASE("Single-threaded policy") {
+    SECTION("Counters") {
+        auto sp = MakeShared<int, SingleThreadedRefCount>(42);
+        SharedPtr<int, SingleThreadedRefCount> sp2 = sp;
+        WeakPtr<int, SingleThreadedRefCount> wp(sp);
+        REQUIRE(sp.UseCount() == 2);
+        REQUIRE(wp.UseCount() == 2);
+
+        sp.Reset();
+        sp2.Reset();
+        REQUIRE(wp.Expired());
+        REQUIRE(wp.Lock().Get() == nullptr);
+    }
+
+    SECTION("Raw pointer") {
+        {
+            SharedPtr<Counted, SingleThreadedRefCount> sp(new Counted);
+            auto sp2 = sp;
+            REQUIRE(Counted::alive == 1);
+        }
+        REQUIRE(Counted::alive == 0);
+    }
+
+    SECTION("No atomics in the control block") {
+        static_assert(sizeof(SingleThreadedRefCount) == 2 * sizeof(size_t));
+        static_assert(!std::is_same_v<SharedPtr<int>, SharedPtr<int, SingleThreadedRefCount>>);
+    }
+}
+
+TEST_CASE("Atomic policy") {
+    SECTION("Is the default one") {
+        static_assert(std::is_same_v<SharedPtr<int>, SharedPtr<int, AtomicRefCount>>);
+        static_assert(std::is_same_v<WeakPtr<int>, WeakPtr<int, AtomicRefCount>>);
+    }
+
+    SECTION("Weak pointer outlives the object") {
+        WeakPtr<Counted> wp;
+        {
+            auto sp = MakeShared<Counted>();
+            wp = sp;
+            REQUIRE(Counted::alive == 1);
+        }
+        REQUIRE(Counted::alive == 0);
+        REQUIRE(wp.Expired());
+    }
+
+    SECTION("Copies from many threads") {
+        constexpr int kThreads = 4;
+        constexpr int kIterations = 10'000;
+
+        auto sp = MakeShared<Counted>();
+        WeakPtr<Counted> wp(sp);
+        std::vector<std::thread> threads;
+        for (int i = 0; i < kThreads; ++i) {
+            threads.emplace_back([copy = sp] {
+                for (int j = 0; j < kIterations; ++j) {
+                    SharedPtr<Counted> local = copy;
+                    WeakPtr<Counted> weak(local);
+                    SharedPtr<Counted> moved = std::move(local);
+                }
+            });
+        }
+        sp.Reset();
+        for (auto& thread : threads) {
+            thread.join();
+        }
+
+        REQUIRE(Counted::alive == 0);
+        REQUIRE(wp.Expired());
+    }
+}
+
+TEST_CASE("Biased policy") {
+    using Ptr = SharedPtr<Counted, BiasedRefCount>;
+    using Weak = WeakPtr<Counted, BiasedRefCount>;
+
+    SECTION("Owner thread") {
+        auto sp = MakeShared<Counted, BiasedRefCount>();
+        Ptr sp2 = sp;
+        Weak wp(sp);
+        REQUIRE(sp.UseCount() == 2);
+        REQUIRE(wp.Lock().UseCount() == 3);
+
+        sp.Reset();
+        REQUIRE(Counted::alive == 1);
+        sp2.Reset();
+        REQUIRE(Counted::alive == 0);
+        REQUIRE(wp.Expired());
+    }
+
+    SECTION("Copy dies on another thread") {
+        auto sp = MakeShared<Counted, BiasedRefCount>();
+        std::thread([copy = sp]() mutable {
+            Ptr local = copy;
+            REQUIRE(local.UseCount() == 3);
+        }).join();
+        REQUIRE(sp.UseCount() == 1);
+        sp.Reset();
+        REQUIRE(Counted::alive == 0);
+    }
+
+    SECTION("Last reference dies on another thread") {
+        auto sp = MakeShared<Counted, BiasedRefCount>();
+        Weak wp(sp);
+        std::thread([moved = std::move(sp)]() mutable { moved.Reset(); }).join();
+
+        // The other thread can't tell whether it was the last one, the owner decides
+        REQUIRE(wp.Expired());
+        REQUIRE(Counted::alive == 1);
+        BiasedRefCount::ProcessQueue();
+        REQUIRE(Counted::alive == 0);
+    }
+
+    SECTION("Owner exits first") {
+        Ptr escaped;
+        std::thread([&escaped] { escaped = MakeShared<Counted, BiasedRefCount>(); }).join();
+        REQUIRE(escaped.UseCount() == 1);
+        Ptr copy = escaped;
+        escaped.Reset();
+        copy.Reset();
+        REQUIRE(Counted::alive == 0);
+    }
+
+    SECTION("Copies from many threads") {
+        constexpr int kThreads = 4;
+        constexpr int kIterations = 10'000;
+
+        auto sp = MakeShared<Counted, BiasedRefCount>();
+        Weak wp(sp);
+        std::vector<std::thread> threads;
+        for (int i = 0; i < kThreads; ++i) {
+            threads.emplace_back([copy = sp, &wp] {
+                for (int j = 0; j < kIterations; ++j) {
+                    Ptr local = copy;
+                    auto locked = wp.Lock();
+                    Ptr moved = std::move(local);
+                }
+            });
+        }
+        for (int j = 0; j < kIterations; ++j) {
+            Ptr local = sp;
+        }
+        sp.Reset();
+        for (auto& thread : threads) {
+            thread.join();
+        }
+
+        BiasedRefCount::ProcessQueue();
+        REQUIRE(Counted::alive == 0);
+        REQUIRE(wp.Expired());
+    }
+}
+
+TEST_CASE("TryLock") {
+    SECTION("Alive object") {
+        auto sp = MakeShared<int>(42);
+        WeakPtr<int> wp(sp);
+        SharedPtr<int> locked;
+        REQUIRE(wp.TryLock(locked));
+        REQUIRE(locked == sp);
+        REQUIRE(sp.UseCount() == 2);
+
+        REQUIRE(wp.TryLock(locked));
+        REQUIRE(sp.UseCount() == 2);
+    }
+
+    SECTION("Expired object") {
+        auto sp = MakeShared<int>(42);
+        WeakPtr<int> wp(sp);
+        SharedPtr<int> locked = MakeShared<int>(1);
+        sp.Reset();
+        REQUIRE(!wp.TryLock(locked));
+        REQUIRE(locked.Get() == nullptr);
+        REQUIRE(!WeakPtr<int>().TryLock(locked));
+    }
+
+    SECTION("Races with the last owner") {
+        constexpr int kThreads = 4;
+        constexpr int kRounds = 1'000;
+
+        for (int round = 0; round < kRounds; ++round) {
+            auto sp = MakeShared<Counted>();
+            WeakPtr<Counted> wp(sp);
+            std::vector<std::thread> threads;
+            for (int i = 0; i < kThreads; ++i) {
+                threads.emplace_back([&wp] {
+                    auto locked = wp.Lock();
+                });
+            }
+            sp.Reset();
+            for (auto& thread : threads) {
+                thread.join();
+            }
+            REQUIRE(wp.Expired());
+            REQUIRE(Counted::alive == 0);
+        }
+    }
+}
+
+TEST_CASE("Packed policy") {
+    using Ptr = SharedPtr<Counted, PackedRefCount>;
+    using Weak = WeakPtr<Counted, PackedRefCount>;
+
+    static_assert(sizeof(PackedRefCount) == sizeof(uint64_t));
+    static_assert(sizeof(IControlBlock<PackedRefCount>) == 2 * sizeof(void*));
+    static_assert(sizeof(ControlBlockHolder<int, PackedRefCount>) <
+                  sizeof(ControlBlockHolder<int, AtomicRefCount>));
+
+    SECTION("Counters") {
+        auto sp = MakeShared<Counted, PackedRefCount>();
+        Ptr copy = sp;
+        Weak wp(sp);
+        Weak wp2 = wp;
+        REQUIRE(sp.UseCount() == 2);
+        REQUIRE(Counted::alive == 1);
+
+        sp.Reset();
+        REQUIRE(wp.UseCount() == 1);
+        copy.Reset();
+        REQUIRE(Counted::alive == 0);
+        REQUIRE(wp.Expired());
+        REQUIRE(wp2.Lock().Get() == nullptr);
+    }
+
+    SECTION("Last owner without weak pointers") {
+        {
+            Ptr sp(new Counted);
+            REQUIRE(Counted::alive == 1);
+        }
+        REQUIRE(Counted::alive == 0);
+    }
+
+    SECTION("Weak pointers outlive the object") {
+        Weak wp;
+        {
+            auto sp = MakeShared<Counted, PackedRefCount>();
+            wp = sp;
+            REQUIRE(wp.Lock().UseCount() == 2);
+        }
+        REQUIRE(Counted::alive == 0);
+        REQUIRE(wp.Expired());
+    }
+
+    SECTION("Threads") {
+        auto sp = MakeShared<Counted, PackedRefCount>();
+        Weak wp(sp);
+        std::vector<std::thread> threads;
+        for (int i = 0; i < 4; ++i) {
+            threads.emplace_back([sp, wp] {
+                for (int j = 0; j < 10000; ++j) {
+                    Ptr copy = sp;
+                    auto locked = wp.Lock();
+                }
+            });
+        }
+        sp.Reset();
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        REQUIRE(wp.Expired());
+        REQUIRE(Counted::alive == 0);
+    }
+}
+
+TEST_CASE("Control block layout") {
+    using Holder = ControlBlockHolder<int, SingleThreadedRefCount>;
+    using Ptr = ControlBlockPtr<int, SingleThreadedRefCount>;
+
+    static_assert(!std::is_polymorphic_v<Holder>);
+    static_assert(!std::is_polymorphic_v<Ptr>);
+    static_assert(sizeof(Holder) == sizeof(SingleThreadedRefCount) + 2 * sizeof(void*));
+    static_assert(sizeof(Ptr) == sizeof(SingleThreadedRefCount) + 2 * sizeof(void*));
+
+    SECTION("Last owner without weak pointers") {
+        {
+            auto sp = MakeShared<Counted>();
+            REQUIRE(Counted::alive == 1);
+        }
+        REQUIRE(Counted::alive == 0);
+    }
+}
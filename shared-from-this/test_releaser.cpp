@@ -0,0 +1,123 @@
+#include "releaser.h"
+#include "shared.h"
+#include "weak.h"
+#include "biased_ref_count.h"
+#include "pool_allocator.h"
+
+#include <catch.hpp>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+struct Node {
+    Node() {
+        alive.fetch_add(1);
+    }
+
+    ~Node() {
+        alive.fetch_sub(1);
+    }
+
+    SharedPtr<Node> next;
+
+    inline static std::atomic<int> alive = 0;
+};
+
+}  // namespace
+
+TEST_CASE("SharedPtrReleaser") {
+    SECTION("References are dropped on Flush") {
+        SharedPtrReleaser<> releaser;
+        auto first = MakeShared<Node>();
+        auto second = MakeShared<Node>();
+        auto copy = second;
+
+        releaser.Add(std::move(first));
+        releaser.Add(std::move(second));
+        REQUIRE(!first);
+        REQUIRE(!second);
+        REQUIRE(releaser.Size() == 2);
+        REQUIRE(copy.UseCount() == 2);
+        REQUIRE(Node::alive.load() == 2);
+
+        releaser.Flush();
+        REQUIRE(releaser.Empty());
+        REQUIRE(Node::alive.load() == 1);
+        REQUIRE(copy.UseCount() == 1);
+    }
+
+    SECTION("Weak pointers expire on Flush") {
+        SharedPtrReleaser<> releaser;
+        auto sp = MakeShared<Node>();
+        WeakPtr<Node> wp(sp);
+        releaser.Add(std::move(sp));
+        REQUIRE(!wp.Expired());
+        releaser.Flush();
+        REQUIRE(wp.Expired());
+        REQUIRE(Node::alive.load() == 0);
+    }
+
+    SECTION("Empty pointers are ignored") {
+        SharedPtrReleaser<> releaser;
+        releaser.Add(SharedPtr<Node>());
+        REQUIRE(releaser.Empty());
+    }
+
+    SECTION("Destructor flushes") {
+        {
+            SharedPtrReleaser<> releaser(16);
+            for (int i = 0; i < 16; ++i) {
+                releaser.Add(MakeShared<Node>());
+            }
+            REQUIRE(Node::alive.load() == 16);
+        }
+        REQUIRE(Node::alive.load() == 0);
+    }
+
+    SECTION("Chains are released by the objects") {
+        SharedPtrReleaser<> releaser;
+        auto head = MakeShared<Node>();
+        head->next = MakeShared<Node>();
+        head->next->next = SharedPtr<Node>(new Node);
+        releaser.Add(std::move(head));
+        REQUIRE(Node::alive.load() == 3);
+        releaser.Flush();
+        REQUIRE(Node::alive.load() == 0);
+    }
+
+    SECTION("Move assignment flushes the old batch") {
+        SharedPtrReleaser<> first;
+        SharedPtrReleaser<> second;
+        first.Add(MakeShared<Node>());
+        second.Add(MakeShared<Node>());
+        first = std::move(second);
+        REQUIRE(Node::alive.load() == 1);
+        REQUIRE(first.Size() == 1);
+    }
+
+    SECTION("Flush on another thread") {
+        constexpr int kCount = 1000;
+        SharedPtrReleaser<> releaser(kCount);
+        for (int i = 0; i < kCount; ++i) {
+            releaser.Add(AllocateShared<Node>(PoolAllocator<Node>()));
+        }
+        REQUIRE(releaser.Size() == kCount);
+        std::thread([releaser = std::move(releaser)]() mutable { releaser.Flush(); }).join();
+        REQUIRE(Node::alive.load() == 0);
+    }
+
+    SECTION("Other policies") {
+        SharedPtrReleaser<SingleThreadedRefCount> single;
+        single.Add(MakeShared<int, SingleThreadedRefCount>(1));
+        REQUIRE(single.Size() == 1);
+
+        SharedPtrReleaser<BiasedRefCount> biased;
+        biased.Add(MakeShared<int, BiasedRefCount>(1));
+        REQUIRE(biased.Size() == 1);
+    }
+}
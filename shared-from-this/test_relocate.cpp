@@ -0,0 +1,153 @@
+#include "compact_shared.h"
+#include "shared.h"
+#include "weak.h"
+#include <common/my_int.h>
+#include <common/relocating_vector.h>
+#include <intrusive/intrusive.h>
+#include <unique/unique.h>
+
+#include <catch.hpp>
+
+#include <limits>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+struct Node : EnableSharedFromThis<Node> {
+    explicit Node(int id) : id(id) {
+    }
+
+    int id;
+};
+
+struct Counted : SimpleRefCounted<Counted> {
+    MyInt value;
+};
+
+struct StatefulDelete {
+    std::string name;
+
+    void operator()(int* ptr) const {
+        delete ptr;
+    }
+};
+
+struct Fragile {
+    explicit Fragile(bool fail) : value(1) {
+        if (fail) {
+            throw std::runtime_error("Fragile");
+        }
+    }
+
+    MyInt value;
+};
+
+}  // namespace
+
+static_assert(TriviallyRelocatable<int>);
+static_assert(TriviallyRelocatable<SharedPtr<int>>);
+static_assert(TriviallyRelocatable<SharedPtr<Node, SingleThreadedRefCount>>);
+static_assert(TriviallyRelocatable<WeakPtr<Node>>);
+static_assert(TriviallyRelocatable<CompactSharedPtr<int>>);
+static_assert(TriviallyRelocatable<IntrusivePtr<Counted>>);
+static_assert(TriviallyRelocatable<UniquePtr<int>>);
+static_assert(TriviallyRelocatable<UniquePtr<int[]>>);
+static_assert(TriviallyRelocatable<const UniquePtr<int>>);
+static_assert(!TriviallyRelocatable<UniquePtr<int, StatefulDelete>>);
+static_assert(!TriviallyRelocatable<std::string>);
+
+TEST_CASE("RelocatingVector of SharedPtr") {
+    RelocatingVector<SharedPtr<Node>> nodes;
+    std::vector<WeakPtr<Node>> weak;
+    for (int i = 0; i < 1000; ++i) {
+        nodes.EmplaceBack(MakeShared<Node>(i));
+        weak.emplace_back(nodes[i]);
+    }
+    REQUIRE(nodes.Size() == 1000);
+    REQUIRE(nodes.Capacity() >= 1000);
+    for (int i = 0; i < 1000; ++i) {
+        REQUIRE(nodes[i]->id == i);
+        REQUIRE(nodes[i].UseCount() == 1);
+        REQUIRE(nodes[i]->SharedFromThis().Get() == nodes[i].Get());  // `weak_this_` is intact
+    }
+
+    nodes.PopBack();
+    REQUIRE(weak[999].Expired());
+    nodes.Clear();
+    for (const auto& ptr : weak) {
+        REQUIRE(ptr.Expired());
+    }
+}
+
+TEST_CASE("RelocatingVector of UniquePtr and IntrusivePtr") {
+    {
+        RelocatingVector<UniquePtr<MyInt>> owned;
+        RelocatingVector<IntrusivePtr<Counted>> counted;
+        for (int i = 0; i < 100; ++i) {
+            owned.PushBack(MakeUnique<MyInt>(i));
+            counted.PushBack(MakeIntrusive<Counted>());
+        }
+        REQUIRE(MyInt::AliveCount() == 200);
+        REQUIRE(*owned[99] == 99);
+
+        auto moved = std::move(owned);
+        REQUIRE(owned.Empty());  // NOLINT
+        REQUIRE(moved.Size() == 100);
+        REQUIRE(MyInt::AliveCount() == 200);
+    }
+    REQUIRE(MyInt::AliveCount() == 0);
+}
+
+TEST_CASE("RelocatingVector of other types") {
+    RelocatingVector<std::string> strings;
+    for (int i = 0; i < 100; ++i) {
+        strings.EmplaceBack(std::to_string(i) + " is long enough to be on the heap");
+    }
+    strings.Reserve(1000);
+    REQUIRE(strings.Capacity() == 1000);
+    REQUIRE(strings[42] == "42 is long enough to be on the heap");
+
+    size_t total = 0;
+    for (const auto& string : strings) {
+        total += string.size();
+    }
+    REQUIRE(total > 100);
+}
+
+TEST_CASE("RelocatingVector: an element pushed into its own vector") {
+    RelocatingVector<SharedPtr<int>> values;
+    values.PushBack(MakeShared<int>(1));
+    while (values.Size() < 100) {
+        values.PushBack(values[0]);  // the growth must not invalidate the argument first
+    }
+    REQUIRE(values[0].UseCount() == 100);
+    REQUIRE(*values[99] == 1);
+}
+
+TEST_CASE("RelocatingVector: failures") {
+    {
+        RelocatingVector<Fragile> values;
+        values.EmplaceBack(false);
+        REQUIRE_THROWS_AS(values.EmplaceBack(true), std::runtime_error);
+        REQUIRE(values.Size() == 1);
+        while (values.Size() < values.Capacity()) {
+            values.EmplaceBack(false);
+        }
+        REQUIRE_THROWS_AS(values.EmplaceBack(true), std::runtime_error);  // the one made to grow
+        REQUIRE(values.Size() == values.Capacity());
+        REQUIRE(MyInt::AliveCount() == static_cast<int>(values.Size()));
+    }
+    REQUIRE(MyInt::AliveCount() == 0);
+
+    RelocatingVector<SharedPtr<int>> pointers;
+    pointers.PushBack(MakeShared<int>(1));
+    REQUIRE_THROWS_AS(pointers.Reserve(std::numeric_limits<size_t>::max() / 4),
+                      std::bad_array_new_length);
+    REQUIRE(pointers.Size() == 1);
+    REQUIRE(*pointers[0] == 1);
+}
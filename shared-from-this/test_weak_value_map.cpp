@@ -0,0 +1,273 @@
+#include "weak_value_map.h"
+#include "shared.h"
+#include "allocations_checker.h"
+
+#include <catch.hpp>
+
+#include <array>
+#include <cstddef>
+#include <map>
+#include <string>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+// Everything in one chain: the backward shift of the erase is what's tested
+struct CollidingHash {
+    size_t operator()(int) const noexcept {
+        return 0;
+    }
+};
+
+// Every key goes to slot 14 of a 16-slot table, so the cluster wraps past the end. The map mixes
+// hashes by multiplying with the golden ratio, this is the hash which mixes to exactly that
+constexpr size_t kGolden = 0x9E3779B97F4A7C15ULL;
+
+constexpr size_t Inverse(size_t odd) {
+    size_t inverse = odd;  // Newton's iteration, every step doubles the correct low bits
+    for (int i = 0; i < 6; ++i) {
+        inverse *= 2 - odd * inverse;
+    }
+    return inverse;
+}
+
+struct WrappingHash {
+    size_t operator()(int) const noexcept {
+        return (size_t{14} << 60) * Inverse(kGolden);
+    }
+};
+
+size_t LiveAllocations() {
+    return alloc_checker::AllocCount() - alloc_checker::DeallocCount();
+}
+
+}  // namespace
+
+TEST_CASE("WeakValueMap: find and insert") {
+    WeakValueMap<std::string, int> map;
+    REQUIRE(map.Empty());
+    REQUIRE(!map.Find("a"));
+
+    auto a = MakeShared<int>(1);
+    auto b = MakeShared<int>(2);
+    map.Insert("a", a);
+    map.Insert("b", b);
+    REQUIRE(map.Size() == 2);
+    REQUIRE(map.Find("a").Get() == a.Get());
+    REQUIRE(map.Find("b").Get() == b.Get());
+    REQUIRE(!map.Find("c"));
+    REQUIRE(a.UseCount() == 1);  // the map holds weak references only
+
+    auto other = MakeShared<int>(3);
+    map.Insert("a", other);
+    REQUIRE(map.Size() == 2);
+    REQUIRE(map.Find("a").Get() == other.Get());
+
+    REQUIRE(map.Erase("a"));
+    REQUIRE(!map.Erase("a"));
+    REQUIRE(!map.Find("a"));
+    REQUIRE(map.Size() == 1);
+
+    map.Clear();
+    REQUIRE(map.Empty());
+    REQUIRE(!map.Find("b"));
+}
+
+TEST_CASE("WeakValueMap: dead entries are dropped") {
+    WeakValueMap<int, int> map;
+    auto value = MakeShared<int>(42);
+    map.Insert(1, value);
+
+    value.Reset();
+    REQUIRE(map.Size() == 1);
+    REQUIRE(!map.Find(1));
+    REQUIRE(map.Size() == 0);
+}
+
+TEST_CASE("WeakValueMap: sweeping frees the control blocks") {
+    const auto live = LiveAllocations();
+    {
+        WeakValueMap<int, int> map(64);
+        const auto empty = LiveAllocations();
+        for (int i = 0; i < 32; ++i) {
+            map.Insert(i, MakeShared<int>(i));  // dies right away, the block stays
+        }
+        REQUIRE(map.Size() < 32);  // the inserts have swept a part already
+        REQUIRE(LiveAllocations() > empty);
+
+        map.Sweep();
+        REQUIRE(map.Empty());
+        REQUIRE(LiveAllocations() == empty);
+    }
+    REQUIRE(LiveAllocations() == live);
+}
+
+TEST_CASE("WeakValueMap: lookups sweep incrementally") {
+    WeakValueMap<int, int> map;
+    std::vector<SharedPtr<int>> values;
+    for (int i = 0; i < 10; ++i) {
+        values.push_back(MakeShared<int>(i));
+        map.Insert(i, values.back());
+    }
+    values.clear();
+
+    // Two slots every eighth lookup: a missing key still gets the whole table swept
+    for (size_t i = 0; i < map.Capacity() * 8; ++i) {
+        REQUIRE(!map.Find(100));
+    }
+    REQUIRE(map.Empty());
+}
+
+TEST_CASE("WeakValueMap: a full table of dead entries doesn't grow") {
+    WeakValueMap<int, int> map;
+    const auto capacity = [&] {
+        map.Insert(0, MakeShared<int>(0));
+        return map.Capacity();
+    }();
+    for (int i = 0; i < 1000; ++i) {
+        map.Insert(i, MakeShared<int>(i));
+    }
+    REQUIRE(map.Capacity() == capacity);
+}
+
+TEST_CASE("WeakValueMap: growth keeps the live entries") {
+    WeakValueMap<int, std::string> map;
+    std::vector<SharedPtr<std::string>> values;
+    for (int i = 0; i < 1000; ++i) {
+        values.push_back(MakeShared<std::string>(std::to_string(i)));
+        map.Insert(i, values.back());
+    }
+    REQUIRE(map.Size() == 1000);
+    REQUIRE(map.Capacity() >= 1024);
+    for (int i = 0; i < 1000; ++i) {
+        REQUIRE(*map.Find(i) == std::to_string(i));
+    }
+}
+
+TEST_CASE("WeakValueMap: erase in a collision chain") {
+    WeakValueMap<int, int, AtomicRefCount, CollidingHash> map;
+    std::vector<SharedPtr<int>> values;
+    for (int i = 0; i < 10; ++i) {
+        values.push_back(MakeShared<int>(i));
+        map.Insert(i, values.back());
+    }
+
+    // Every other one dies, the rest must still be found behind the holes
+    for (int i = 0; i < 10; i += 2) {
+        values[i].Reset();
+    }
+    map.Sweep();
+    REQUIRE(map.Size() == 5);
+    for (int i = 0; i < 10; ++i) {
+        REQUIRE(static_cast<bool>(map.Find(i)) == (i % 2 == 1));
+    }
+
+    REQUIRE(map.Erase(1));
+    REQUIRE(map.Erase(9));
+    for (int i : {3, 5, 7}) {
+        REQUIRE(*map.Find(i) == i);
+    }
+}
+
+TEST_CASE("WeakValueMap: GetOrCreate") {
+    WeakValueMap<int, int> map;
+    int made = 0;
+    auto make = [&] {
+        ++made;
+        return MakeShared<int>(made);
+    };
+
+    auto first = map.GetOrCreate(1, make);
+    auto second = map.GetOrCreate(1, make);
+    REQUIRE(made == 1);
+    REQUIRE(first.Get() == second.Get());
+
+    first.Reset();
+    second.Reset();
+    auto third = map.GetOrCreate(1, make);
+    REQUIRE(made == 2);
+    REQUIRE(*third == 2);
+}
+
+TEST_CASE("WeakValueMap: FindAll") {
+    WeakValueMap<int, int> map;
+    auto one = MakeShared<int>(1);
+    auto two = MakeShared<int>(2);
+    map.Insert(1, one);
+    map.Insert(2, two);
+    map.Insert(3, MakeShared<int>(3));
+
+    const std::array keys = {3, 1, 4, 2, 1};
+    std::array<SharedPtr<int>, keys.size()> out;
+    map.FindAll(keys, out);
+    REQUIRE(!out[0]);
+    REQUIRE(out[1].Get() == one.Get());
+    REQUIRE(!out[2]);
+    REQUIRE(out[3].Get() == two.Get());
+    REQUIRE(out[4].Get() == one.Get());
+    REQUIRE(map.Size() == 2);  // the dead one is gone
+}
+
+TEST_CASE("WeakValueMap: LockAll") {
+    WeakValueMap<int, int> map;
+    std::vector<SharedPtr<int>> values;
+    for (int i = 0; i < 100; ++i) {
+        values.push_back(MakeShared<int>(i));
+        map.Insert(i, values.back());
+    }
+    for (int i = 0; i < 100; i += 3) {
+        values[i].Reset();
+    }
+
+    std::map<int, int> seen;
+    auto live = map.LockAll([&](int key, SharedPtr<int> value) { seen[key] = *value; });
+    REQUIRE(live == 66);
+    REQUIRE(map.Size() == 66);
+    REQUIRE(seen.size() == 66);
+    for (const auto& [key, value] : seen) {
+        REQUIRE(key % 3 != 0);
+        REQUIRE(key == value);
+    }
+}
+
+TEST_CASE("WeakValueMap: a cluster across the end of the table") {
+    static_assert(Inverse(kGolden) * kGolden == 1);
+    WeakValueMap<int, int, AtomicRefCount, WrappingHash> map;
+    auto second = MakeShared<int>(2);
+    auto third = MakeShared<int>(3);
+    map.Insert(1, MakeShared<int>(1));  // slot 14, dead
+    map.Insert(2, second);              // slot 15
+    map.Insert(3, third);               // slot 0
+    REQUIRE(map.Capacity() == 16);
+
+    std::map<int, int> seen;
+    auto live = map.LockAll([&](int key, const SharedPtr<int>&) { ++seen[key]; });
+    REQUIRE(live == 2);
+    REQUIRE(map.Size() == 2);
+    REQUIRE(seen == std::map<int, int>{{2, 1}, {3, 1}});
+
+    second.Reset();
+    map.Sweep();
+    REQUIRE(map.Size() == 1);
+    REQUIRE(map.Find(3).Get() == third.Get());
+    REQUIRE(!map.Find(2));
+}
+
+TEST_CASE("WeakValueMap: move") {
+    WeakValueMap<int, int> map;
+    auto value = MakeShared<int>(1);
+    map.Insert(1, value);
+
+    auto moved = std::move(map);
+    REQUIRE(moved.Find(1).Get() == value.Get());
+    REQUIRE(map.Empty());  // NOLINT
+    REQUIRE(!map.Find(1));
+
+    map.Insert(2, value);
+    REQUIRE(map.Find(2).Get() == value.Get());
+    map = std::move(moved);
+    REQUIRE(map.Find(1).Get() == value.Get());
+    REQUIRE(!map.Find(2));
+}
@@ -4,17 +4,22 @@
 #include "shared.h"
 
 // https://en.cppreference.com/w/cpp/memory/weak_ptr
-template <typename T>
+template <typename T, typename RefCount>
 class WeakPtr {
 private:
-    template <typename Y>
+    template <typename Y, typename R>
     friend class SharedPtr;
 
-    template <typename Y>
+    template <typename Y, typename R>
     friend class WeakPtr;
 
-    T* ptr_ = nullptr;                 // pointer to type
-    IControlBlock* cblock_ = nullptr;  // pointer to the control block that owns the object
+    template <class K, class V, class R, class H, class E>
+    friend class WeakValueMap;  // prefetches the control blocks
+
+    using ControlBlock = IControlBlock<RefCount>;
+
+    std::remove_extent_t<T>* ptr_ = nullptr;  // pointer to type, the first element for arrays
+    ControlBlock* cblock_ = nullptr;  // pointer to the control block that owns the object
 public:
     ////////////////////////////////////////////////////////////////////////////////////////////////
     // Constructors
@@ -28,7 +33,7 @@ public:
     };
 
     template <class Y>
-    WeakPtr(const WeakPtr<Y>& other) noexcept : ptr_(other.ptr_), cblock_(other.cblock_) {
+    WeakPtr(const WeakPtr<Y, RefCount>& other) noexcept : ptr_(other.ptr_), cblock_(other.cblock_) {
         if (cblock_ != nullptr) {
             cblock_->AddWeakRef();  // increment weak refs counter
         }
@@ -39,20 +44,30 @@ public:
     };
 
     template <class Y>
-    WeakPtr(WeakPtr<Y>&& other) noexcept : ptr_(other.ptr_), cblock_(other.cblock_) {
+    WeakPtr(WeakPtr<Y, RefCount>&& other) noexcept : ptr_(other.ptr_), cblock_(other.cblock_) {
         other.Zeroing();
     }
 
     // Demote `SharedPtr`
     // #2 from https://en.cppreference.com/w/cpp/memory/weak_ptr/weak_ptr
-    WeakPtr(const SharedPtr<T>& other) noexcept : ptr_(other.ptr_), cblock_(other.cblock_) {
+    WeakPtr(const SharedPtr<T, RefCount>& other) noexcept
+        : ptr_(other.ptr_), cblock_(other.cblock_) {
         if (cblock_ != nullptr) {
             cblock_->AddWeakRef();  // increment weak refs counter
         }
     };
 
     template <class Y>
-    WeakPtr(const SharedPtr<T>& other) noexcept : ptr_(other.ptr_), cblock_(other.cblock_) {
+    WeakPtr(const SharedPtr<T, RefCount>& other) noexcept
+        : ptr_(other.ptr_), cblock_(other.cblock_) {
+        if (cblock_ != nullptr) {
+            cblock_->AddWeakRef();  // increment weak refs counter
+        }
+    }
+
+    // Needs compact_shared.h, the object is found from the block
+    WeakPtr(const CompactSharedPtr<T, RefCount>& other) noexcept
+        : ptr_(other.Get()), cblock_(other.cblock_) {
         if (cblock_ != nullptr) {
             cblock_->AddWeakRef();  // increment weak refs counter
         }
@@ -74,7 +89,7 @@ public:
     };
 
     template <class Y>
-    WeakPtr& operator=(const WeakPtr<Y>& other) noexcept {
+    WeakPtr& operator=(const WeakPtr<Y, RefCount>& other) noexcept {
         if (this != &other) {
             this->Release();    // release old object
             ptr_ = other.ptr_;  // seizure of shared possession
@@ -87,7 +102,7 @@ public:
     }
 
     template <class Y>
-    WeakPtr& operator=(SharedPtr<Y>& other) noexcept {
+    WeakPtr& operator=(SharedPtr<Y, RefCount>& other) noexcept {
         this->Release();    // release old object
         ptr_ = other.ptr_;  // seizure of shared possession
         cblock_ = other.cblock_;
@@ -108,7 +123,7 @@ public:
     };
 
     template <class Y>
-    WeakPtr& operator=(WeakPtr<Y>&& other) noexcept {
+    WeakPtr& operator=(WeakPtr<Y, RefCount>&& other) noexcept {
         if (this != &other) {
             this->Release();    // release old object
             ptr_ = other.ptr_;  // seizure of shared possession (at this moment it only this)
@@ -136,9 +151,6 @@ public:
     void Release() noexcept {
         if (cblock_ != nullptr) {
             cblock_->RemoveWeakRef();  // decrement weak refs counter
-            if (cblock_->IsZeroStrongOwning() && cblock_->IsZeroWeakOwning()) {
-                cblock_->Destroy();
-            }
         }
         this->Zeroing();
     }
@@ -147,7 +159,7 @@ public:
         this->Release();  // "nullptred" this - After the call, *this manages no object
     }
 
-    void Swap(WeakPtr<T>& other) noexcept {
+    void Swap(WeakPtr& other) noexcept {
         std::swap(cblock_, other.cblock_);
         std::swap(ptr_, other.ptr_);
     }
@@ -166,10 +178,27 @@ public:
         return UseCount() == 0;
     };
 
-    template <typename U, typename... Args>
-    friend SharedPtr<U> MakeShared(Args&&... args);
-
-    SharedPtr<T> Lock() const noexcept {
-        return Expired() ? SharedPtr<T>() : SharedPtr<T>(*this);
+    // Never throws, yields an empty pointer if the object has expired
+    SharedPtr<T, RefCount> Lock() const noexcept {
+        SharedPtr<T, RefCount> result;
+        TryLock(result);
+        return result;
     };
+
+    // Same as `Lock()`, but reuses `result` and reports whether the object is still alive.
+    // Checking `Expired()` first would race with the last owner, so the strong counter is
+    // incremented only if it's still nonzero
+    bool TryLock(SharedPtr<T, RefCount>& result) const noexcept {
+        if (cblock_ == nullptr || !cblock_->TryAddStrongRef()) {
+            result.Reset();
+            return false;
+        }
+        result.Reset();
+        result.ptr_ = ptr_;
+        result.cblock_ = cblock_;
+        return true;
+    }
 };
+
+template <typename T, typename RefCount>
+struct IsTriviallyRelocatable<WeakPtr<T, RefCount>> : std::true_type {};
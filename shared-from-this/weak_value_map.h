@@ -0,0 +1,396 @@
+#pragma once
+
+#include "shared.h"
+#include "weak.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <span>
+#include <utility>
+#include <vector>
+
+// A cache of objects owned elsewhere: `Key -> WeakPtr<V>` which forgets the objects that are gone.
+//
+//     WeakValueMap<std::string, Texture> textures;
+//     auto texture = textures.GetOrCreate(path, [&] { return Load(path); });
+//
+// WeakPtr-s of dead objects still pin their control blocks, with `MakeShared` the whole object's
+// memory, so they're swept: a lookup which finds one drops it, and inserts and lookups check a few
+// more slots with a cursor that runs over the table. A full `Sweep()` also runs before the table
+// grows.
+//
+// Open addressing with linear probing: one byte per slot with 7 bits of the hash is probed first,
+// so a miss rarely touches the keys. Deletion shifts the following entries back, there are no
+// tombstones. Not thread-safe, like the standard containers.
+template <class Key, class V, class RefCount = AtomicRefCount, class Hash = std::hash<Key>,
+          class KeyEqual = std::equal_to<Key>>
+class WeakValueMap {
+public:
+    using Value = SharedPtr<V, RefCount>;
+
+private:
+    using Weak = WeakPtr<V, RefCount>;
+
+    static_assert(sizeof(size_t) == sizeof(uint64_t), "the hash is mixed as a 64-bit word");
+
+    struct Slot {
+        Key key;
+        Weak value;
+    };
+
+    static constexpr uint8_t kEmpty = 0;
+    static constexpr uint8_t kFull = 0x80;  // | 7 bits of the hash
+    static constexpr size_t kMinCapacity = 16;
+    static constexpr size_t kSweepStep = 2;  // slots checked by every insert
+    // A lookup sweeps much less: the check is a cache miss on a block, which would double the
+    // cost of a hit. Dead entries are made by objects dying, not by lookups, so inserts do most
+    static constexpr size_t kLookupsPerSweep = 8;
+    static constexpr size_t kNotFound = ~size_t{0};
+
+    // Control blocks are scattered over the heap, load a few of them ahead in batches
+    static constexpr size_t kPrefetchDistance = 8;
+    static constexpr size_t kBatch = 16;  // keys of `FindAll` in flight
+
+    [[no_unique_address]] Hash hash_;
+    [[no_unique_address]] KeyEqual equal_;
+    std::vector<uint8_t> control_;
+    Slot* slots_ = nullptr;  // constructed where `control_` isn't empty
+    size_t size_ = 0;
+    int shift_ = 64;    // the home slot is the top bits of the mixed hash
+    size_t sweep_ = 0;  // where the incremental sweep goes on
+    size_t lookups_ = 0;
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Hashing
+
+    // Fibonacci hashing: an identity `std::hash` still spreads over the top bits
+    size_t Mix(const Key& key) const {
+        return static_cast<size_t>(hash_(key)) * 0x9E3779B97F4A7C15ULL;
+    }
+
+    size_t Home(size_t mixed) const noexcept {
+        return mixed >> shift_;
+    }
+
+    uint8_t Tag(size_t mixed) const noexcept {
+        return kFull | static_cast<uint8_t>((mixed >> (shift_ - 7)) & 0x7f);
+    }
+
+    size_t Mask() const noexcept {
+        return control_.size() - 1;
+    }
+
+    size_t FindIndex(const Key& key, size_t mixed) const {
+        if (size_ == 0) {
+            return kNotFound;
+        }
+        const auto tag = Tag(mixed);
+        for (auto i = Home(mixed); control_[i] != kEmpty; i = (i + 1) & Mask()) {
+            if (control_[i] == tag && equal_(slots_[i].key, key)) {
+                return i;
+            }
+        }
+        return kNotFound;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Storage
+
+    static Slot* Allocate(size_t capacity) {
+        return std::allocator<Slot>().allocate(capacity);
+    }
+
+    static void Deallocate(Slot* slots, size_t capacity) noexcept {
+        if (slots != nullptr) {
+            std::allocator<Slot>().deallocate(slots, capacity);
+        }
+    }
+
+    void DestroyAll() noexcept {
+        for (size_t i = 0; i < control_.size(); ++i) {
+            if (control_[i] != kEmpty) {
+                std::destroy_at(&slots_[i]);
+            }
+        }
+    }
+
+    // The new table gets the entries in their old order, which keeps every probe chain intact
+    void Rehash(size_t capacity) {
+        std::vector<uint8_t> control(capacity, kEmpty);
+        auto slots = Allocate(capacity);
+        const int shift = 64 - std::countr_zero(capacity);
+
+        auto old_control = std::exchange(control_, std::move(control));
+        auto old_slots = std::exchange(slots_, slots);
+        shift_ = shift;
+        sweep_ = 0;
+        for (size_t i = 0; i < old_control.size(); ++i) {
+            if (old_control[i] != kEmpty) {
+                auto mixed = Mix(old_slots[i].key);
+                auto j = Home(mixed);
+                while (control_[j] != kEmpty) {
+                    j = (j + 1) & Mask();
+                }
+                std::construct_at(&slots_[j], std::move(old_slots[i]));
+                std::destroy_at(&old_slots[i]);
+                control_[j] = Tag(mixed);
+            }
+        }
+        Deallocate(old_slots, old_control.size());
+    }
+
+    // Keep the load under 3/4. Dead entries go first, the table grows if it's still over half full
+    void ReserveOneMore() {
+        if (control_.empty()) {
+            Rehash(kMinCapacity);
+        } else if ((size_ + 1) * 4 > control_.size() * 3) {
+            Sweep();
+            if (size_ * 2 > control_.size()) {
+                Rehash(control_.size() * 2);
+            }
+        }
+    }
+
+    // Backward shift: the entries after the hole which may take it move closer to their home
+    void EraseAt(size_t hole) {
+        std::destroy_at(&slots_[hole]);
+        control_[hole] = kEmpty;
+        --size_;
+        for (auto i = (hole + 1) & Mask(); control_[i] != kEmpty; i = (i + 1) & Mask()) {
+            auto home = Home(Mix(slots_[i].key));
+            if (((i - home) & Mask()) >= ((i - hole) & Mask())) {
+                std::construct_at(&slots_[hole], std::move(slots_[i]));
+                std::destroy_at(&slots_[i]);
+                control_[hole] = std::exchange(control_[i], kEmpty);
+                hole = i;
+            }
+        }
+    }
+
+    // An erased slot may take the next entry, so it's checked again
+    void SweepStep() {
+        for (size_t step = 0; step < kSweepStep && size_ != 0; ++step) {
+            auto i = sweep_ & Mask();
+            if (control_[i] != kEmpty && slots_[i].value.Expired()) {
+                EraseAt(i);
+            } else {
+                sweep_ = i + 1;
+            }
+        }
+    }
+
+    // Runs `keep(i)` once for every entry and erases those it returns false for. The scan starts
+    // after an empty slot and goes round to it: the shifts of the erases never cross that slot, so
+    // no entry is moved to a place the scan has passed, however the clusters wrap
+    template <class F>
+    void Filter(F&& keep) {
+        if (size_ == 0) {
+            return;
+        }
+        size_t start = 0;
+        while (control_[start] != kEmpty) {  // the load is under 3/4, there is one
+            ++start;
+        }
+        for (auto i = (start + 1) & Mask(); i != start;) {
+            if (control_[i] != kEmpty && !keep(i)) {
+                EraseAt(i);  // the next entry may move here, so `i` is looked at again
+            } else {
+                i = (i + 1) & Mask();
+            }
+        }
+    }
+
+    void Prefetch(size_t i) const noexcept {
+        if (control_[i] != kEmpty) {
+            __builtin_prefetch(slots_[i].value.cblock_);
+        }
+    }
+
+public:
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Constructors
+
+    WeakValueMap() noexcept = default;
+
+    explicit WeakValueMap(size_t capacity) {
+        Reserve(capacity);
+    }
+
+    WeakValueMap(WeakValueMap&& other) noexcept
+        : hash_(std::move(other.hash_)),
+          equal_(std::move(other.equal_)),
+          control_(std::move(other.control_)),
+          slots_(std::exchange(other.slots_, nullptr)),
+          size_(std::exchange(other.size_, 0)),
+          shift_(std::exchange(other.shift_, 64)),
+          sweep_(std::exchange(other.sweep_, 0)),
+          lookups_(std::exchange(other.lookups_, 0)) {
+        other.control_.clear();
+    }
+
+    WeakValueMap& operator=(WeakValueMap&& other) noexcept {
+        WeakValueMap(std::move(other)).Swap(*this);
+        return *this;
+    }
+
+    WeakValueMap(const WeakValueMap&) = delete;
+    WeakValueMap& operator=(const WeakValueMap&) = delete;
+
+    ~WeakValueMap() {
+        DestroyAll();
+        Deallocate(slots_, control_.size());
+    }
+
+    void Swap(WeakValueMap& other) noexcept {
+        std::swap(hash_, other.hash_);
+        std::swap(equal_, other.equal_);
+        std::swap(control_, other.control_);
+        std::swap(slots_, other.slots_);
+        std::swap(size_, other.size_);
+        std::swap(shift_, other.shift_);
+        std::swap(sweep_, other.sweep_);
+        std::swap(lookups_, other.lookups_);
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Lookup
+
+    // Empty if there's no entry or its object is gone; a dead entry is dropped
+    Value Find(const Key& key) {
+        if (++lookups_ % kLookupsPerSweep == 0) {
+            SweepStep();
+        }
+        auto i = FindIndex(key, Mix(key));
+        if (i == kNotFound) {
+            return {};
+        }
+        auto value = slots_[i].value.Lock();
+        if (!value) {
+            EraseAt(i);
+        }
+        return value;
+    }
+
+    // `make()` is called and its result remembered if there's no live object for `key`
+    template <class F>
+    Value GetOrCreate(const Key& key, F&& make) {
+        auto value = Find(key);
+        if (!value) {
+            value = std::forward<F>(make)();
+            Insert(key, value);
+        }
+        return value;
+    }
+
+    // Looks the `keys` up in batches: the slots are found and their control blocks prefetched
+    // first, so the misses overlap. `out[i]` is the object for `keys[i]` or empty
+    void FindAll(std::span<const Key> keys, std::span<Value> out) {
+        for (size_t begin = 0; begin < keys.size(); begin += kBatch) {
+            const auto count = std::min(kBatch, keys.size() - begin);
+            std::array<size_t, kBatch> found;
+            for (size_t k = 0; k < count; ++k) {
+                found[k] = FindIndex(keys[begin + k], Mix(keys[begin + k]));
+                if (found[k] != kNotFound) {
+                    Prefetch(found[k]);
+                }
+            }
+            bool dead = false;
+            for (size_t k = 0; k < count; ++k) {
+                out[begin + k] = found[k] == kNotFound ? Value() : slots_[found[k]].value.Lock();
+                dead |= found[k] != kNotFound && !out[begin + k];
+            }
+            // Erasing moves entries, so only once the batch's indices aren't needed
+            for (size_t k = 0; dead && k < count; ++k) {
+                if (found[k] != kNotFound && !out[begin + k]) {
+                    Erase(keys[begin + k]);
+                }
+            }
+        }
+    }
+
+    // Calls `visit(key, value)` for every live entry and drops the dead ones. `visit` mustn't
+    // change the map. Returns the number of live entries
+    template <class F>
+    size_t LockAll(F&& visit) {
+        size_t live = 0;
+        Filter([&](size_t i) {
+            Prefetch((i + kPrefetchDistance) & Mask());
+            auto value = slots_[i].value.Lock();
+            if (!value) {
+                return false;
+            }
+            visit(std::as_const(slots_[i].key), std::move(value));
+            ++live;
+            return true;
+        });
+        return live;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Modifiers
+
+    // Replaces the entry for `key` if there is one
+    void Insert(const Key& key, const Value& value) {
+        SweepStep();
+        auto mixed = Mix(key);
+        auto i = FindIndex(key, mixed);
+        if (i != kNotFound) {
+            slots_[i].value = value;
+            return;
+        }
+        ReserveOneMore();
+        for (i = Home(mixed); control_[i] != kEmpty; i = (i + 1) & Mask()) {
+        }
+        std::construct_at(&slots_[i], Slot{key, Weak(value)});
+        control_[i] = Tag(mixed);
+        ++size_;
+    }
+
+    bool Erase(const Key& key) {
+        auto i = FindIndex(key, Mix(key));
+        if (i == kNotFound) {
+            return false;
+        }
+        EraseAt(i);
+        return true;
+    }
+
+    // Drops every dead entry now
+    void Sweep() {
+        Filter([&](size_t i) { return !slots_[i].value.Expired(); });
+    }
+
+    void Reserve(size_t size) {
+        auto capacity = std::max(kMinCapacity, std::bit_ceil(size + size / 3 + 1));
+        if (capacity > control_.size()) {
+            Rehash(capacity);
+        }
+    }
+
+    void Clear() noexcept {
+        DestroyAll();
+        std::fill(control_.begin(), control_.end(), kEmpty);
+        size_ = 0;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Observers
+
+    // Entries, the dead ones not swept yet included
+    size_t Size() const noexcept {
+        return size_;
+    }
+
+    bool Empty() const noexcept {
+        return size_ == 0;
+    }
+
+    size_t Capacity() const noexcept {
+        return control_.size();
+    }
+};
@@ -1,11 +1,4 @@
 #pragma once
 
-#include <exception>
-
-class BadWeakPtr : public std::exception {};
-
-template <typename T>
-class SharedPtr;
-
-template <typename T>
-class WeakPtr;
+// The only implementation lives in shared-from-this/, this path is kept for existing includes
+#include <shared-from-this/sw_fwd.h>
@@ -0,0 +1,90 @@
+#include "workload.h"
+#include "allocations_checker.h"
+
+#include <shared-from-this/biased_ref_count.h>
+#include <shared-from-this/packed_ref_count.h>
+
+#include <catch.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Meant to be run under TSAN too, so the number of operations is modest: the interleavings come
+// from the threads, not from the length of the run
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+constexpr size_t kPoolSize = 16;
+constexpr size_t kOpsPerThread = 20'000;
+
+size_t ThreadCount() {
+    return std::clamp<size_t>(std::thread::hardware_concurrency(), 4, 16);
+}
+
+template <class Workload>
+stress::Result RunThreads(Workload& workload, size_t threads) {
+    std::vector<stress::Result> results(threads);
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < threads; ++i) {
+        workers.emplace_back([&, i] { results[i] = workload.Run(kOpsPerThread, i + 1); });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    stress::Result total;
+    for (const auto& result : results) {
+        total.ops += result.ops;
+        total.locks += result.locks;
+        total.failed_locks += result.failed_locks;
+    }
+    return total;
+}
+
+size_t LiveAllocations() {
+    return alloc_checker::AllocCount() - alloc_checker::DeallocCount();
+}
+
+}  // namespace
+
+TEMPLATE_TEST_CASE("Stress: SharedPtr + WeakPtr", "", AtomicRefCount, PackedRefCount,
+                   BiasedRefCount) {
+    const auto threads = ThreadCount();
+    const auto live = LiveAllocations();
+    {
+        stress::SharedWorkload<TestType> workload(kPoolSize);
+        auto total = RunThreads(workload, threads);
+        if constexpr (std::is_same_v<TestType, BiasedRefCount>) {
+            BiasedRefCount::ProcessQueue();  // the pool's first objects were made on this thread
+        }
+        REQUIRE(total.ops == threads * kOpsPerThread);
+        REQUIRE(total.failed_locks <= total.locks);
+        REQUIRE(MyInt::AliveCount() >= 0);
+        REQUIRE(MyInt::AliveCount() <= static_cast<int>(kPoolSize));  // the threads let go
+    }
+    REQUIRE(MyInt::AliveCount() == 0);
+    if constexpr (std::is_same_v<TestType, BiasedRefCount>) {
+        // The owner records of the workers and of this thread are never freed
+        REQUIRE(LiveAllocations() <= live + threads + 1);
+    } else {
+        REQUIRE(LiveAllocations() == live);
+    }
+}
+
+TEST_CASE("Stress: IntrusivePtr") {
+    const auto threads = ThreadCount();
+    const auto live = LiveAllocations();
+    {
+        stress::IntrusiveWorkload workload(kPoolSize);
+        auto total = RunThreads(workload, threads);
+        REQUIRE(total.ops == threads * kOpsPerThread);
+        REQUIRE(MyInt::AliveCount() <= static_cast<int>(kPoolSize));
+    }
+    REQUIRE(MyInt::AliveCount() == 0);
+    REQUIRE(LiveAllocations() == live);
+}
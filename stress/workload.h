@@ -0,0 +1,187 @@
+#pragma once
+
+#include <common/my_int.h>
+#include <intrusive/intrusive.h>
+#include <shared-from-this/atomic_shared.h>
+#include <shared-from-this/shared.h>
+#include <shared-from-this/weak.h>
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// Random pointer operations of many threads on a pool of objects they all share. Used by the stress
+// test under TSAN and by bench/stress.cpp for the throughput at different thread counts.
+//
+// Each thread keeps a few pointers of its own and copies, moves, resets and locks them. The pool is
+// where the threads meet: objects are loaded from it and replaced in it, so the last owner and the
+// `WeakPtr::Lock`-s racing with it may be on any thread.
+namespace stress {
+
+// xorshift64*, every thread has its own
+class Random {
+public:
+    explicit Random(uint64_t seed) noexcept : state_(seed | 1) {
+    }
+
+    uint32_t operator()(uint32_t bound) noexcept {
+        state_ ^= state_ >> 12;
+        state_ ^= state_ << 25;
+        state_ ^= state_ >> 27;
+        return static_cast<uint32_t>(((state_ * 0x2545F4914F6CDD1DULL) >> 32) % bound);
+    }
+
+private:
+    uint64_t state_;
+};
+
+struct Result {
+    size_t ops = 0;
+    size_t locks = 0;
+    size_t failed_locks = 0;  // the object was replaced in the pool and dropped by everybody else
+};
+
+inline constexpr size_t kLocalSlots = 8;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// `SharedPtr` + `WeakPtr`, the pool is made of `AtomicSharedPtr`-s
+
+template <class RefCount = AtomicRefCount>
+class SharedWorkload {
+private:
+    using Ptr = SharedPtr<MyInt, RefCount>;
+    using Weak = WeakPtr<MyInt, RefCount>;
+
+    size_t size_;
+    std::unique_ptr<AtomicSharedPtr<MyInt, RefCount>[]> pool_;
+
+public:
+    explicit SharedWorkload(size_t size)
+        : size_(size), pool_(new AtomicSharedPtr<MyInt, RefCount>[size]) {
+        for (size_t i = 0; i < size_; ++i) {
+            pool_[i].Store(MakeShared<MyInt, RefCount>(static_cast<int>(i)));
+        }
+    }
+
+    // One thread's share of the work; every thread needs its own `seed`
+    Result Run(size_t ops, uint64_t seed) {
+        Random random(seed);
+        std::array<Ptr, kLocalSlots> local;
+        std::array<Weak, kLocalSlots> weak;
+        Result result;
+
+        for (size_t op = 0; op < ops; ++op) {
+            auto& mine = local[random(kLocalSlots)];
+            auto& other = local[random(kLocalSlots)];
+            auto& shared = pool_[random(static_cast<uint32_t>(size_))];
+            switch (random(8)) {
+                case 0:
+                    mine = shared.Load();
+                    break;
+                case 1:
+                    mine = other;
+                    break;
+                case 2:
+                    mine = std::move(other);
+                    break;
+                case 3:
+                    mine.Reset();
+                    break;
+                case 4:
+                    weak[random(kLocalSlots)] = mine;
+                    break;
+                case 5: {
+                    auto locked = weak[random(kLocalSlots)].Lock();
+                    ++result.locks;
+                    result.failed_locks += !locked;
+                    break;
+                }
+                case 6:
+                    shared.Store(MakeShared<MyInt, RefCount>(static_cast<int>(op)));
+                    break;
+                case 7:
+                    if (mine) {
+                        shared.Store(mine);
+                    }
+                    break;
+            }
+        }
+        result.ops = ops;
+        return result;
+    }
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// `IntrusivePtr`, the pool is made of hand-off slots: a thread swaps its reference for whatever the
+// slot held, so the objects wander between the threads
+
+struct CountedInt : ThreadSafeRefCounted<CountedInt> {
+    explicit CountedInt(int value) : value(value) {
+    }
+
+    MyInt value;
+};
+
+class IntrusiveWorkload {
+private:
+    using Ptr = IntrusivePtr<CountedInt>;
+
+    size_t size_;
+    std::unique_ptr<std::atomic<CountedInt*>[]> pool_;
+
+public:
+    explicit IntrusiveWorkload(size_t size)
+        : size_(size), pool_(new std::atomic<CountedInt*>[size]) {
+        for (size_t i = 0; i < size_; ++i) {
+            pool_[i].store(MakeIntrusive<CountedInt>(static_cast<int>(i)).Detach(),
+                           std::memory_order_relaxed);
+        }
+    }
+
+    IntrusiveWorkload(const IntrusiveWorkload&) = delete;
+    IntrusiveWorkload& operator=(const IntrusiveWorkload&) = delete;
+
+    ~IntrusiveWorkload() {
+        for (size_t i = 0; i < size_; ++i) {
+            Ptr adopted(pool_[i].load(std::memory_order_acquire), kAdoptRef);
+        }
+    }
+
+    Result Run(size_t ops, uint64_t seed) {
+        Random random(seed);
+        std::array<Ptr, kLocalSlots> local;
+        Result result;
+
+        for (size_t op = 0; op < ops; ++op) {
+            auto& mine = local[random(kLocalSlots)];
+            auto& other = local[random(kLocalSlots)];
+            switch (random(5)) {
+                case 0:
+                    mine = other;
+                    break;
+                case 1:
+                    mine = std::move(other);
+                    break;
+                case 2:
+                    mine.Reset();
+                    break;
+                case 3:
+                    mine = MakeIntrusive<CountedInt>(static_cast<int>(op));
+                    break;
+                case 4: {
+                    auto& slot = pool_[random(static_cast<uint32_t>(size_))];
+                    // Acquire: the object may have been made or last used on another thread
+                    auto old = slot.exchange(mine.Detach(), std::memory_order_acq_rel);
+                    mine = Ptr(old, kAdoptRef);
+                    break;
+                }
+            }
+        }
+        result.ops = ops;
+        return result;
+    }
+};
+
+}  // namespace stress
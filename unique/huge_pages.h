@@ -0,0 +1,100 @@
+#pragma once
+
+#include "unique.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <new>
+#include <type_traits>
+
+#include <sys/mman.h>
+
+// Multi-megabyte buffers on 2 MiB pages: one TLB entry covers 512 times more memory, so random
+// access over big arrays stops missing the TLB on every other load.
+//
+// Explicit huge pages (`MAP_HUGETLB`) are used when the system has reserved some, otherwise the
+// mapping is aligned to 2 MiB and handed to transparent huge pages with `madvise`. The memory
+// comes zeroed from the kernel, which is exactly value-initialization for trivial types.
+
+inline constexpr size_t kHugePageSize = size_t{2} << 20;
+
+// Has to remember the length of the mapping, so unlike `Slug` it takes a word
+template <class T>
+class HugePageDelete;
+
+template <class T>
+class HugePageDelete<T[]> {
+public:
+    HugePageDelete() noexcept = default;
+
+    explicit HugePageDelete(size_t bytes) noexcept : bytes_(bytes) {
+    }
+
+    void operator()(T* ptr) const noexcept {
+        munmap(ptr, bytes_);
+    }
+
+    size_t Bytes() const noexcept {
+        return bytes_;
+    }
+
+private:
+    size_t bytes_ = 0;
+};
+
+// `bytes` must be a multiple of the huge page size
+inline void* MapHugePages(size_t bytes) {
+    constexpr int kProtection = PROT_READ | PROT_WRITE;
+    constexpr int kFlags = MAP_PRIVATE | MAP_ANONYMOUS;
+
+#ifdef MAP_HUGETLB
+    if (auto memory = mmap(nullptr, bytes, kProtection, kFlags | MAP_HUGETLB, -1, 0);
+        memory != MAP_FAILED) {
+        return memory;
+    }
+#endif
+
+    // Over-map by a page and cut the ends off, so that the kernel can use huge pages for all of it
+    auto raw = mmap(nullptr, bytes + kHugePageSize, kProtection, kFlags, -1, 0);
+    if (raw == MAP_FAILED) {
+        throw std::bad_alloc();
+    }
+    auto address = reinterpret_cast<std::uintptr_t>(raw);
+    auto aligned = (address + kHugePageSize - 1) / kHugePageSize * kHugePageSize;
+    if (auto head = aligned - address) {
+        munmap(raw, head);
+    }
+    if (auto tail = kHugePageSize - (aligned - address)) {
+        munmap(reinterpret_cast<void*>(aligned + bytes), tail);
+    }
+    auto memory = reinterpret_cast<void*>(aligned);
+#ifdef MADV_HUGEPAGE
+    madvise(memory, bytes, MADV_HUGEPAGE);  // only a hint, the buffer works either way
+#endif
+    return memory;
+}
+
+// `size` value-initialized elements, rounded up to whole huge pages. Trivially constructible ones
+// are the kernel's zeroes, others are constructed, e.g. those with default member initializers.
+// Nobody calls destructors on such a buffer, so only trivially destructible `T`-s are allowed
+template <class T>
+    requires std::is_unbounded_array_v<T>
+UniquePtr<T, HugePageDelete<T>> MakeUniqueHugePages(size_t size) {
+    using Element = std::remove_extent_t<T>;
+    static_assert(std::is_trivially_destructible_v<Element>,
+                  "huge page buffers don't run destructors");
+    static_assert(alignof(Element) <= kHugePageSize);
+    if (size > (std::numeric_limits<size_t>::max() - 2 * kHugePageSize) / sizeof(Element)) {
+        throw std::bad_array_new_length();
+    }
+    auto bytes = (size * sizeof(Element) + kHugePageSize - 1) / kHugePageSize * kHugePageSize;
+    bytes = bytes == 0 ? kHugePageSize : bytes;
+    auto memory = static_cast<Element*>(MapHugePages(bytes));
+    UniquePtr<T, HugePageDelete<T>> buffer(memory, HugePageDelete<T>(bytes));
+    if constexpr (!std::is_trivially_default_constructible_v<Element>) {
+        std::uninitialized_value_construct_n(memory, size);
+    }
+    return buffer;
+}
@@ -1,10 +1,14 @@
 #include "unique.h"
+#include "huge_pages.h"
+#include "unique_array.h"
 
 #include "deleters.h"
 
 #include <common/my_int.h>
 
 #include <catch.hpp>
+#include <numeric>
+#include <span>
 #include <vector>
 #include <tuple>
 
@@ -414,6 +418,124 @@ TEST_CASE("Array specialization") {
     }
 }
 
+TEST_CASE("Factories") {
+    SECTION("MakeUnique") {
+        auto u = MakeUnique<std::pair<int, int>>(1, 2);
+        REQUIRE(u->second == 2);
+
+        auto array = MakeUnique<MyInt[]>(10);
+        REQUIRE(MyInt::AliveCount() == 10);
+        array.Reset();
+        REQUIRE(MyInt::AliveCount() == 0);
+
+        auto zeros = MakeUnique<int[]>(16);
+        for (int i = 0; i < 16; ++i) {
+            REQUIRE(zeros[i] == 0);
+        }
+    }
+
+    SECTION("MakeUniqueForOverwrite") {
+        auto u = MakeUniqueForOverwrite<MyInt>();
+        REQUIRE(MyInt::AliveCount() == 1);
+        auto buffer = MakeUniqueForOverwrite<float[]>(1024);
+        buffer[1023] = 1.0f;
+        REQUIRE(buffer[1023] == 1.0f);
+    }
+
+    SECTION("MakeUniqueAligned") {
+        static_assert(sizeof(UniquePtr<float[], AlignedFree<float[]>>) == sizeof(float*));
+
+        for (size_t alignment : {16, 64, 4096}) {
+            auto buffer = MakeUniqueAligned<float[]>(1000, alignment);
+            REQUIRE(reinterpret_cast<uintptr_t>(buffer.Get()) % alignment == 0);
+            REQUIRE(buffer[0] == 0.0f);
+            REQUIRE(buffer[999] == 0.0f);
+        }
+        REQUIRE_THROWS_AS(MakeUniqueAligned<float[]>(1, 48), std::invalid_argument);
+        REQUIRE_THROWS_AS(MakeUniqueAligned<double[]>(1, 4), std::invalid_argument);
+    }
+
+    SECTION("MakeUniqueHugePages") {
+        constexpr size_t kSize = 3 * kHugePageSize / sizeof(float) + 1;
+        auto buffer = MakeUniqueHugePages<float[]>(kSize);
+        REQUIRE(reinterpret_cast<uintptr_t>(buffer.Get()) % kHugePageSize == 0);
+        REQUIRE(buffer.GetDeleter().Bytes() == 4 * kHugePageSize);
+        REQUIRE(buffer[kSize - 1] == 0.0f);
+        buffer[kSize - 1] = 1.0f;
+        buffer.Reset();
+
+        struct Point {
+            int x = 1;
+            int y = -1;
+        };
+        auto points = MakeUniqueHugePages<Point[]>(1000);
+        REQUIRE(points[0].x == 1);
+        REQUIRE(points[999].y == -1);
+    }
+}
+
+TEST_CASE("UniqueArray") {
+    SECTION("Size and ranges") {
+        static_assert(sizeof(UniqueArray<int>) == 2 * sizeof(void*));
+        auto array = MakeUniqueArray<int>(16);
+        REQUIRE(array.Size() == 16);
+        REQUIRE(array[15] == 0);
+        std::iota(array.begin(), array.end(), 1);
+
+        int sum = 0;
+        for (auto value : array) {
+            sum += value;
+        }
+        REQUIRE(sum == 136);
+
+        std::span<const int> view = array;
+        REQUIRE(view.size() == 16);
+        REQUIRE(view.data() == array.Get());
+        REQUIRE(std::accumulate(view.begin(), view.end(), 0) == 136);
+    }
+
+    SECTION("Elements are destroyed") {
+        {
+            auto array = MakeUniqueArray<MyInt>(3);
+            REQUIRE(MyInt::AliveCount() == 3);
+            auto other = std::move(array);
+            REQUIRE(!array);
+            REQUIRE(array.Empty());
+            REQUIRE(other.Size() == 3);
+        }
+        REQUIRE(MyInt::AliveCount() == 0);
+    }
+
+    SECTION("Modifiers") {
+        UniqueArray<int> array;
+        REQUIRE(array.Empty());
+        array.Reset(new int[4](), 4);
+        REQUIRE(array.Size() == 4);
+        UniqueArray<int> other(new int[2](), 2);
+        array.Swap(other);
+        REQUIRE(array.Size() == 2);
+        REQUIRE(other.Size() == 4);
+        delete[] other.Release();
+        REQUIRE(other.Size() == 0);
+        array = nullptr;
+        REQUIRE(!array);
+    }
+
+    SECTION("From UniquePtr") {
+        UniqueArray aligned(MakeUniqueAligned<float[]>(64, 64), 64);
+        static_assert(std::is_same_v<decltype(aligned), UniqueArray<float, AlignedFree<float[]>>>);
+        REQUIRE(aligned.Size() == 64);
+        REQUIRE(reinterpret_cast<uintptr_t>(aligned.Get()) % 64 == 0);
+        REQUIRE(aligned[63] == 0.0f);
+    }
+
+    SECTION("For overwrite") {
+        auto array = MakeUniqueArrayForOverwrite<char>(1 << 16);
+        REQUIRE(array.Size() == 1 << 16);
+        array[0] = 'a';
+    }
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 template <typename T>
@@ -421,6 +543,17 @@ void DeleteFunction(T* ptr) {
     delete ptr;
 }
 
+template <typename T>
+struct FinalDeleter final {
+    void operator()(std::remove_extent_t<T>* ptr) const {
+        if constexpr (std::is_array_v<T>) {
+            delete[] ptr;
+        } else {
+            delete ptr;
+        }
+    }
+};
+
 template <typename T>
 struct StatefulDeleter {
     int some_useless_field = 0;
@@ -462,6 +595,56 @@ TEST_CASE("Compressed pair usage") {
         static_assert(sizeof(UniquePtr<int, decltype(&DeleteFunction<int>)>) ==
                       sizeof(std::pair<int*, decltype(&DeleteFunction<int>)>));
     }
+
+    SECTION("Final stateless deleter") {
+        static_assert(sizeof(UniquePtr<int, FinalDeleter<int>>) == sizeof(int*));
+        static_assert(sizeof(UniquePtr<int[], FinalDeleter<int[]>>) == sizeof(int*));
+        UniquePtr<int[], FinalDeleter<int[]>> array(new int[4]);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Everything but the aligned and huge-page factories works in constant evaluation
+
+namespace {
+
+constexpr int ConstantEvaluated() {
+    UniquePtr<int> a(new int(1));
+    auto b = MakeUnique<int>(2);
+    a.Swap(b);
+    int sum = *a * 10 + *b;  // 21
+
+    UniquePtr<int> c(std::move(a));
+    b = std::move(c);
+    sum += *b * 100;  // 221
+
+    b.Reset(new int(3));
+    auto raw = b.Release();
+    sum += *raw * 1000;  // 3221
+    delete raw;
+
+    auto array = MakeUnique<int[]>(3);
+    array[2] = 4;
+    sum += array[2] * 10000;  // 43221
+    array = nullptr;
+    return sum + static_cast<bool>(array);
+}
+
+}  // namespace
+
+TEST_CASE("Constant evaluation") {
+    static_assert(ConstantEvaluated() == 43221);
+
+    constexpr UniquePtr<int> kEmpty;
+    static_assert(!kEmpty && kEmpty.Get() == nullptr);
+
+    // As cheap to pass as the pointer where the ABI allows: Clang has `trivial_abi`
+    static_assert(std::is_nothrow_move_constructible_v<UniquePtr<int>>);
+#if defined(__clang__) && __has_builtin(__is_trivially_relocatable)
+    static_assert(__is_trivially_relocatable(UniquePtr<int>));
+    static_assert(__is_trivially_relocatable(UniquePtr<int[]>));
+#endif
+    REQUIRE(ConstantEvaluated() == 43221);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
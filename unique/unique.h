@@ -1,20 +1,38 @@
 #pragma once
 
 #include "compressed_pair.h"
+#include <common/relocatable.h>
 
 #include <cstddef>      // std::nullptr_t
+#include <cstdlib>      // std::aligned_alloc
+#include <limits>
+#include <memory>       // std::uninitialized_value_construct_n
+#include <new>
+#include <stdexcept>
 #include <type_traits>  // std::nullptr_t
 
+// Clang passes a `[[clang::trivial_abi]]` class in registers, like a raw pointer, instead of on the
+// stack: the callee destroys it, which moving it around bit by bit doesn't break. The attribute is
+// dropped on its own if a deleter isn't trivially movable. GCC has no such thing
+#if defined(__clang__) && defined(__has_cpp_attribute)
+#if __has_cpp_attribute(clang::trivial_abi)
+#define UNIQUE_PTR_TRIVIAL_ABI [[clang::trivial_abi]]
+#endif
+#endif
+#ifndef UNIQUE_PTR_TRIVIAL_ABI
+#define UNIQUE_PTR_TRIVIAL_ABI
+#endif
+
 template <class T>
 struct [[maybe_unused]] Slug {
     constexpr Slug() noexcept = default;
 
     template <class Up>
         requires std::is_base_of_v<T, Up>
-    [[maybe_unused]] Slug(Slug<Up>&&) noexcept {
+    [[maybe_unused]] constexpr Slug(Slug<Up>&&) noexcept {
     }
 
-    void operator()(T* ptr) const noexcept {
+    constexpr void operator()(T* ptr) const noexcept {
         static_assert(!std::is_void<T>::value, "can't delete pointer to incomplete type");
         static_assert(sizeof(T) > 0, "can't delete pointer to incomplete type");
         delete ptr;
@@ -27,10 +45,10 @@ struct [[maybe_unused]] Slug<T[]> {
 
     template <class Up>
         requires std::is_base_of_v<T, Up>
-    [[maybe_unused]] Slug(Slug<Up>&&) noexcept {
+    [[maybe_unused]] constexpr Slug(Slug<Up>&&) noexcept {
     }
 
-    void operator()(T* ptr) const noexcept {
+    constexpr void operator()(T* ptr) const noexcept {
         static_assert(sizeof(T) > 0, "can't delete pointer to incomplete type");
         delete[] ptr;
     }
@@ -38,7 +56,7 @@ struct [[maybe_unused]] Slug<T[]> {
 
 // Primary template
 template <typename T, typename Deleter = Slug<T>>
-class UniquePtr {
+class UNIQUE_PTR_TRIVIAL_ABI UniquePtr {
 private:
     CompressedPair<T*, Deleter> data_;  // First = T* ptr_, Second = Deleter deleter
 
@@ -46,13 +64,18 @@ public:
     ////////////////////////////////////////////////////////////////////////////////////////////////
     // Constructors
 
-    explicit UniquePtr(T* ptr = nullptr) noexcept : data_(ptr, Deleter()){};
+    constexpr explicit UniquePtr(T* ptr = nullptr) noexcept : data_(ptr, Deleter()){};
 
-    UniquePtr(T* ptr, Deleter deleter) noexcept
+    constexpr UniquePtr(T* ptr, Deleter deleter) noexcept
         : data_(ptr, std::forward<decltype(deleter)>(deleter)){};
 
+    // Not left to the template below: a class without a move constructor isn't `trivial_abi`
+    constexpr UniquePtr(UniquePtr&& other) noexcept
+        : data_(other.Release(), std::forward<Deleter>(other.GetDeleter())) {
+    }
+
     template <class U, class D>
-    UniquePtr(UniquePtr<U, D>&& other) noexcept
+    constexpr UniquePtr(UniquePtr<U, D>&& other) noexcept
         : data_(other.Release(), std::forward<D>(other.GetDeleter())) {
     }
 
@@ -66,13 +89,13 @@ public:
     UniquePtr& operator=(UniquePtr& other) = delete;
 
     template <class U, class D>
-    UniquePtr& operator=(UniquePtr<U, D>&& other) noexcept {
+    constexpr UniquePtr& operator=(UniquePtr<U, D>&& other) noexcept {
         Reset(other.Release());
         GetDeleter() = std::forward<D>(other.GetDeleter());
         return *this;
     }
 
-    UniquePtr& operator=(std::nullptr_t) noexcept {
+    constexpr UniquePtr& operator=(std::nullptr_t) noexcept {
         Reset();
         return *this;
     }
@@ -80,7 +103,7 @@ public:
     ////////////////////////////////////////////////////////////////////////////////////////////////
     // Destructor
 
-    ~UniquePtr() noexcept {
+    constexpr ~UniquePtr() noexcept {
         auto ptr = Get();
         if (ptr != nullptr) {
             GetDeleter()(ptr);  // no throw
@@ -90,13 +113,13 @@ public:
     ////////////////////////////////////////////////////////////////////////////////////////////////
     // Modifiers
 
-    T* Release() noexcept {
+    constexpr T* Release() noexcept {
         auto current_ptr = Get();
         data_.GetFirst() = nullptr;
         return current_ptr;
     }
 
-    void Reset(T* ptr = nullptr) noexcept {
+    constexpr void Reset(T* ptr = nullptr) noexcept {
         const auto old_ptr = Get();
         data_.GetFirst() = ptr;
         if (old_ptr != nullptr) {
@@ -104,45 +127,47 @@ public:
         }
     }
 
-    void Swap(UniquePtr& other) noexcept {
+    constexpr void Swap(UniquePtr& other) noexcept {
         std::swap(data_.GetFirst(), other.data_.GetFirst());
-        std::swap(data_.GetSecond(), other.data_.GetSecond());
+        if constexpr (!std::is_empty_v<Deleter>) {
+            std::swap(data_.GetSecond(), other.data_.GetSecond());
+        }
     }
 
     ////////////////////////////////////////////////////////////////////////////////////////////////
     // Observers
 
-    T* Get() const noexcept {
+    constexpr T* Get() const noexcept {
         return data_.GetFirst();
     }
 
-    Deleter& GetDeleter() noexcept {
+    constexpr Deleter& GetDeleter() noexcept {
         return data_.GetSecond();
     }
 
-    const Deleter& GetDeleter() const noexcept {
+    constexpr const Deleter& GetDeleter() const noexcept {
         return data_.GetSecond();
     }
 
-    explicit operator bool() const noexcept {
+    constexpr explicit operator bool() const noexcept {
         return Get() != nullptr;
     }
 
     ////////////////////////////////////////////////////////////////////////////////////////////////
     // Single-object dereference operators
 
-    typename std::add_lvalue_reference<T>::type operator*() const noexcept {
+    constexpr typename std::add_lvalue_reference<T>::type operator*() const noexcept {
         return *Get();
     }
 
-    T* operator->() const noexcept {
+    constexpr T* operator->() const noexcept {
         return Get();
     }
 };
 
 // Specialization for arrays
 template <typename T, typename Deleter>
-class UniquePtr<T[], Deleter> {
+class UNIQUE_PTR_TRIVIAL_ABI UniquePtr<T[], Deleter> {
 private:
     CompressedPair<T*, Deleter> data_;  // First = T* ptr_, Second = Deleter deleter
 
@@ -150,13 +175,18 @@ public:
     ////////////////////////////////////////////////////////////////////////////////////////////////
     // Constructors
 
-    explicit UniquePtr(T* ptr = nullptr) noexcept : data_(ptr, Deleter()){};
+    constexpr explicit UniquePtr(T* ptr = nullptr) noexcept : data_(ptr, Deleter()){};
 
-    UniquePtr(T* ptr, Deleter deleter) noexcept
+    constexpr UniquePtr(T* ptr, Deleter deleter) noexcept
         : data_(ptr, std::forward<decltype(deleter)>(deleter)){};
 
+    // Not left to the template below: a class without a move constructor isn't `trivial_abi`
+    constexpr UniquePtr(UniquePtr&& other) noexcept
+        : data_(other.Release(), std::forward<Deleter>(other.GetDeleter())) {
+    }
+
     template <class U, class D>
-    UniquePtr(UniquePtr<U, D>&& other) noexcept
+    constexpr UniquePtr(UniquePtr<U, D>&& other) noexcept
         : data_(other.Release(), std::forward<D>(other.GetDeleter())) {
     }
 
@@ -170,13 +200,13 @@ public:
     UniquePtr& operator=(UniquePtr& other) = delete;
 
     template <class U, class D>
-    UniquePtr& operator=(UniquePtr<U, D>&& other) noexcept {
+    constexpr UniquePtr& operator=(UniquePtr<U, D>&& other) noexcept {
         Reset(other.Release());
         GetDeleter() = std::forward<D>(other.GetDeleter());
         return *this;
     }
 
-    UniquePtr& operator=(std::nullptr_t) noexcept {
+    constexpr UniquePtr& operator=(std::nullptr_t) noexcept {
         Reset();
         return *this;
     }
@@ -184,7 +214,7 @@ public:
     ////////////////////////////////////////////////////////////////////////////////////////////////
     // Destructor
 
-    ~UniquePtr() noexcept {
+    constexpr ~UniquePtr() noexcept {
         auto ptr = Get();
         if (ptr != nullptr) {
             GetDeleter()(ptr);  // no throw
@@ -194,13 +224,13 @@ public:
     ////////////////////////////////////////////////////////////////////////////////////////////////
     // Modifiers
 
-    T* Release() noexcept {
+    constexpr T* Release() noexcept {
         auto current_ptr = Get();
         data_.GetFirst() = nullptr;
         return current_ptr;
     }
 
-    void Reset(T* ptr = nullptr) noexcept {
+    constexpr void Reset(T* ptr = nullptr) noexcept {
         const auto old_ptr = Get();
         data_.GetFirst() = ptr;
         if (old_ptr != nullptr) {
@@ -208,42 +238,113 @@ public:
         }
     }
 
-    void Swap(UniquePtr& other) noexcept {
+    constexpr void Swap(UniquePtr& other) noexcept {
         std::swap(data_.GetFirst(), other.data_.GetFirst());
-        std::swap(data_.GetSecond(), other.data_.GetSecond());
+        if constexpr (!std::is_empty_v<Deleter>) {
+            std::swap(data_.GetSecond(), other.data_.GetSecond());
+        }
     }
 
     ////////////////////////////////////////////////////////////////////////////////////////////////
     // Observers
 
-    T* Get() const noexcept {
+    constexpr T* Get() const noexcept {
         return data_.GetFirst();
     }
 
-    Deleter& GetDeleter() noexcept {
+    constexpr Deleter& GetDeleter() noexcept {
         return data_.GetSecond();
     }
 
-    const Deleter& GetDeleter() const noexcept {
+    constexpr const Deleter& GetDeleter() const noexcept {
         return data_.GetSecond();
     }
 
-    explicit operator bool() const noexcept {
+    constexpr explicit operator bool() const noexcept {
         return Get() != nullptr;
     }
 
-    typename std::add_lvalue_reference<T>::type operator[](size_t i) const noexcept {
+    constexpr typename std::add_lvalue_reference<T>::type operator[](size_t i) const noexcept {
         return Get()[i];
     }
 
     ////////////////////////////////////////////////////////////////////////////////////////////////
     // Single-object dereference operators
 
-    typename std::add_lvalue_reference<T>::type operator*() const noexcept {
+    constexpr typename std::add_lvalue_reference<T>::type operator*() const noexcept {
         return *Get();
     }
 
-    T* operator->() const noexcept {
+    constexpr T* operator->() const noexcept {
         return Get();
     }
 };
+
+// Nothing points to a `UniquePtr`, so it moves with its bytes if the deleter does
+template <typename T, typename Deleter>
+struct IsTriviallyRelocatable<UniquePtr<T, Deleter>> : IsTriviallyRelocatable<Deleter> {};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Factories
+
+template <class T, class... Args>
+    requires(!std::is_array_v<T>)
+constexpr UniquePtr<T> MakeUnique(Args&&... args) {
+    return UniquePtr<T>(new T(std::forward<Args>(args)...));
+}
+
+// `size` value-initialized elements
+template <class T>
+    requires std::is_unbounded_array_v<T>
+constexpr UniquePtr<T> MakeUnique(size_t size) {
+    return UniquePtr<T>(new std::remove_extent_t<T>[size]());
+}
+
+template <class T>
+    requires(!std::is_array_v<T>)
+constexpr UniquePtr<T> MakeUniqueForOverwrite() {
+    return UniquePtr<T>(new T);
+}
+
+// Default-initialized elements: trivial ones keep whatever the memory holds
+template <class T>
+    requires std::is_unbounded_array_v<T>
+constexpr UniquePtr<T> MakeUniqueForOverwrite(size_t size) {
+    return UniquePtr<T>(new std::remove_extent_t<T>[size]);
+}
+
+// Frees memory from `MakeUniqueAligned`. `free` doesn't care about the alignment, so the deleter
+// is empty and `UniquePtr` stays one pointer wide
+template <class T>
+struct AlignedFree;
+
+template <class T>
+struct AlignedFree<T[]> {
+    void operator()(T* ptr) const noexcept {
+        std::free(ptr);
+    }
+};
+
+// `size` value-initialized elements aligned to `alignment`, e.g. for SIMD loads.
+// Nobody calls destructors on such a buffer, so only trivially destructible `T`-s are allowed
+template <class T>
+    requires std::is_unbounded_array_v<T>
+UniquePtr<T, AlignedFree<T>> MakeUniqueAligned(size_t size, size_t alignment) {
+    using Element = std::remove_extent_t<T>;
+    static_assert(std::is_trivially_destructible_v<Element>,
+                  "aligned buffers don't run destructors");
+    if (alignment < alignof(Element) || (alignment & (alignment - 1)) != 0) {
+        throw std::invalid_argument("alignment must be a power of two not less than alignof(T)");
+    }
+    if (size > (std::numeric_limits<size_t>::max() - alignment) / sizeof(Element)) {
+        throw std::bad_array_new_length();
+    }
+    // `aligned_alloc` wants the size to be a multiple of the alignment
+    auto bytes = (size * sizeof(Element) + alignment - 1) / alignment * alignment;
+    auto memory = static_cast<Element*>(std::aligned_alloc(alignment, bytes));
+    if (memory == nullptr) {
+        throw std::bad_alloc();
+    }
+    std::uninitialized_value_construct_n(memory, size);
+    return UniquePtr<T, AlignedFree<T>>(memory);
+}
@@ -0,0 +1,163 @@
+#pragma once
+
+#include "unique.h"
+
+#include <cassert>
+#include <cstddef>
+#include <span>
+#include <type_traits>
+#include <utility>
+
+// `UniquePtr<T[]>` which knows its length. Loops over `begin()`/`end()` or a `std::span` see one
+// contiguous range, so the compiler can vectorize them, and the length can't get out of sync with
+// the buffer. `operator[]` checks the index in debug builds only.
+template <typename T, typename Deleter = Slug<T[]>>
+class UniqueArray {
+private:
+    CompressedPair<std::span<T>, Deleter> data_;  // First = elements, Second = deleter
+
+public:
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Constructors
+
+    UniqueArray() noexcept : data_(std::span<T>(), Deleter()) {
+    }
+
+    UniqueArray(T* ptr, size_t size) noexcept : data_(std::span<T>(ptr, size), Deleter()) {
+    }
+
+    UniqueArray(T* ptr, size_t size, Deleter deleter) noexcept
+        : data_(std::span<T>(ptr, size), std::move(deleter)) {
+    }
+
+    // Takes over a buffer made by one of the `MakeUnique*` factories
+    UniqueArray(UniquePtr<T[], Deleter>&& other, size_t size) noexcept
+        : data_(std::span<T>(other.Get(), size), std::move(other.GetDeleter())) {
+        static_cast<void>(other.Release());
+    }
+
+    UniqueArray(UniqueArray&& other) noexcept
+        : data_(std::exchange(other.data_.GetFirst(), std::span<T>()),
+                std::move(other.GetDeleter())) {
+    }
+
+    UniqueArray(const UniqueArray& other) = delete;
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // `operator=`-s
+
+    UniqueArray& operator=(UniqueArray&& other) noexcept {
+        if (this != &other) {
+            Reset(other.Get(), other.Size());
+            other.data_.GetFirst() = std::span<T>();
+            GetDeleter() = std::move(other.GetDeleter());
+        }
+        return *this;
+    }
+
+    UniqueArray& operator=(const UniqueArray& other) = delete;
+
+    UniqueArray& operator=(std::nullptr_t) noexcept {
+        Reset();
+        return *this;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Destructor
+
+    ~UniqueArray() noexcept {
+        auto ptr = Get();
+        if (ptr != nullptr) {
+            GetDeleter()(ptr);  // no throw
+        }
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Modifiers
+
+    T* Release() noexcept {
+        return std::exchange(data_.GetFirst(), std::span<T>()).data();
+    }
+
+    void Reset(T* ptr = nullptr, size_t size = 0) noexcept {
+        const auto old_ptr = Get();
+        data_.GetFirst() = std::span<T>(ptr, size);
+        if (old_ptr != nullptr) {
+            GetDeleter()(old_ptr);
+        }
+    }
+
+    void Swap(UniqueArray& other) noexcept {
+        std::swap(data_.GetFirst(), other.data_.GetFirst());
+        std::swap(data_.GetSecond(), other.data_.GetSecond());
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Observers
+
+    T* Get() const noexcept {
+        return data_.GetFirst().data();
+    }
+
+    size_t Size() const noexcept {
+        return data_.GetFirst().size();
+    }
+
+    bool Empty() const noexcept {
+        return Size() == 0;
+    }
+
+    Deleter& GetDeleter() noexcept {
+        return data_.GetSecond();
+    }
+
+    const Deleter& GetDeleter() const noexcept {
+        return data_.GetSecond();
+    }
+
+    explicit operator bool() const noexcept {
+        return Get() != nullptr;
+    }
+
+    T& operator[](size_t i) const noexcept {
+        assert(i < Size() && "UniqueArray index out of range");
+        return Get()[i];
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Range access
+
+    T* begin() const noexcept {  // NOLINT: range-for
+        return Get();
+    }
+
+    T* end() const noexcept {  // NOLINT: range-for
+        return Get() + Size();
+    }
+
+    std::span<T> Span() const noexcept {
+        return data_.GetFirst();
+    }
+
+    // Also to `std::span<const T>`
+    template <class U>
+        requires std::is_convertible_v<T (*)[], U (*)[]>
+    operator std::span<U>() const noexcept {
+        return Span();
+    }
+};
+
+template <class T, class D>
+UniqueArray(UniquePtr<T[], D>&&, size_t) -> UniqueArray<T, D>;
+
+// `size` value-initialized elements
+template <class T>
+UniqueArray<T> MakeUniqueArray(size_t size) {
+    return UniqueArray<T>(new T[size](), size);
+}
+
+// Default-initialized elements: trivial ones keep whatever the memory holds
+template <class T>
+UniqueArray<T> MakeUniqueArrayForOverwrite(size_t size) {
+    return UniqueArray<T>(new T[size], size);
+}